@@ -6,23 +6,32 @@
 * The idea is to make a dynamic program that learns to identify the formats, exposing it to multiple files that are known are the format that you want to learn.
 * It will have the commands:
 * 1) -l: learn, the file you want to learn from is indicated. The extension is seen automatically.
-* 2) -p: print, a print is generated from the previously generated "learn" files.
-* 3) -i: identify, the indicated file is compared with the records to try to identify it.
+* 2) -p: print, a print is generated from the previously generated "learn" files (--all: for every learnt extension, in parallel).
+* 3) -i: identify, the indicated file is compared with the records to try to identify it ("-" = the standard input).
+* 4) -c: compile, all the prints are compiled in one binary database that identify maps in memory without parsing it.
+* 5) --serve: the prints are kept loaded and the files to identify are received in a unix socket.
+* 6) --carve: the files inside a raw image (of a disk...) are found by the main headers of the prints, without knowing where they start.
+* 7) --bench: learn, print and identify are timed with a synthetic corpus of known formats.
+* 8) --embed: the prints are written as a C++ header, to build a binary that has them inside and does not need the folder "prints".
 *
 * How it works: The idea is to make a simple program, and not a neural network. The program mainly uses components of the headers in the files to be identified, constant structures that are always repeated
 * and they are easy to identify (we will not review the way the information is stored, or types of compression ... or other complex things.)
 *
 * (1) Learn: To learn, the file to learn will be indicated. When using this for the first time in a new extension:
-* -> The program will generate two new files. These files will be an exact copy of the file that was mentioned in the previous command, one will be straight and the other will be inverted.
+* -> The program will generate a new "learn" file, with a copy of the file that was mentioned in the previous command and two views of it, one straight and the other inverted.
 * When the user uses the command to learn again, in previously learned extensions:
-* (The following is done once for the two generated files, for one the indicated file is read in normal way, for the other it is read backwards)
-* -> The content of the generated file is compared with the new file indicated byte by byte.
-* -> If the bytes are the same, they survive. If the bytes are different, they are removed from the generated file => All these surviving bytes are stored in the correct order in a "learn" file
-* where the removed bytes become blank characters.
+* (The following is done once for the two views, for one the indicated file is read in normal way, for the other it is read backwards)
+* -> The content of the view is compared with the new file indicated byte by byte.
+* -> If the bytes are the same, they survive. If the bytes are different, they are removed from the view => Only the surviving bytes are kept in the "learn" file, together with
+* the list of runs of surviving bytes of each view.
 *
 * (2) Print: The strings contained in the "learn" files are compiled in a "print" file together with the position of the initial byte and the length in bytes of the string.
+* Learn updates the print itself once the extension has learnt two samples, -p can be used to make it with only one.
 * The position of the start byte of the string can be stored relative to the beginning of the file or relative to the end of the file. (Only one print file is generated).
 * The following header will be used to identify a string of characters within the print file <Position | Length | Order> where the order indicates whether it is reading straight = d, or backwards = i.
+* The strings that move a few bytes from one file to another have a fourth field <Position | Length | Order | Window>, they can be found up to Window bytes before or after Position.
+* Strings that are near each other are joined in one with a mask <Position | Length | Order | Window | m>: after its bytes come Length bytes more, 0xFF for the
+* bytes that are compared and 0 for the bytes between the strings, that can be anything.
 *
 * (3) Identify: To identify a file, the "print" file is read. It goes to the positions of the file indicated by it and the strings are compared. An answer will be given in percentages of similarity if
 * multiple answers are possible.
@@ -39,8 +48,10 @@
 * Character ratio: Use the ratio of the characters in the files as a footprint, if there is an extension that mostly uses one character over another, then this footprint will be useful.
 * -> There can be multiple proportions, one general, one from the first third, another from the second third and another from the last third (or divide it into more sections, particularly the first third and the last).
 * Many times the files vary in their structure in the last portion, this could be detected with this method. (If the file is very large the proportion is diluted).
+* -> Done: learn averages the frequencies of the whole file and of each third, the print keeps them and identify adds their similarity to the weight.
 *
 * => Add the possibility of passing more than one file in the learn (-l) command so that PrintTracker learns a whole list of files sequentially.
+* -> Done: -l takes many files and directories, the files are grouped by extension and learnt in parallel, and each "learn" file is written once.
 * => Optimize the commands learn (-l) and identify (-i). (particularly learn this is taking a long time for large files).
 **/
 
@@ -51,7 +62,20 @@
 #include <unistd.h>
 #include <vector>
 #include <dirent.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <sys/un.h>
 #include <bits/stdc++.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+#if defined(__linux__) && __has_include(<linux/io_uring.h>)
+#include <linux/io_uring.h>
+#include <sys/syscall.h>
+#define PRINTRACK_URING
+#endif
 using namespace std;
 
 //USER HELPING FUNCTION:
@@ -63,9 +87,23 @@ void printHelp(int errCode, string text)
         printf("\nPrintTracker is used to identify file formats that have lost their extension.");
         printf("\n\nIt has the commands: \n");
         printf("\n\t-l  : learn, the file you want to learn from is indicated. A file \"learn\" is generated\n\tUSE: printrack -l <file to learn>\n");
-        printf("\n\t-p  : print, a print is generated from the previously generated \"learn\" files, only the file extension must be indicated to generate the \"print\" (Without the dot).\n\t USE: printrack -p <extension from the file>\n");
+        printf("\n\t      With several files or directories (read recursively) they are grouped by extension and learnt in parallel.\n\tUSE: printrack -l <files or directories to learn>\n");
+        printf("\n\t-p  : print, a print is generated from the previously generated \"learn\" files, only the file extension must be indicated to generate the \"print\" (Without the dot).\n\t      The learn command already updates the print once the extension has learnt two samples.\n\t USE: printrack -p <extension from the file>\n");
+        printf("\n\t      With --all the prints of every extension in \"learns\" are made in parallel, and they replace the old ones once all are written.\n\tUSE: printrack -p --all\n");
         //
-        printf("\n\t-i  : identify, the indicated file is compared with the prints to try to identify it.\n\tUSE: printra -i <file to identify>\n");
+        printf("\n\t-i  : identify, the indicated file is compared with the prints to try to identify it. With \"-\" the standard input is read (a pipe).\n\tUSE: printra -i <file to identify>\n");
+        printf("\n\t      With several files or directories (read recursively) they are identified in parallel, and a line is given for each file:\n\t      <file> TAB <extension>:<weight>:<success rate>:<1 if a header matched> ... (\"-\" no match, \"?\" not readable)\n\tUSE: printrack -i <files or directories to identify>\n");
+        printf("\n\t--serve : the prints are loaded once and the files to identify are received in a unix socket, one path per line, answering the line of -i\n\t          for each one. The line RELOAD loads the prints again.\n\tUSE: printrack --serve <socket>\n");
+        printf("\n\t--carve : the files inside a raw image (of a disk...) are searched by the main headers of the prints, and a line is given for each one:\n\t          <offset> TAB <extension> TAB <score>\n\tUSE: printrack --carve <image>\n");
+        printf("\n\t--bench : a synthetic corpus of known formats is generated in the directory, and learn, print and identify are timed with it.\n\tUSE: printrack --bench <directory>\n");
+        printf("\n\t--budget : bytes that are read from each file to measure the frequencies of its bytes (1 MiB by default, 0 = they are not measured).\n\tUSE: printrack -i <file to identify> --budget <bytes>\n");
+        printf("\n\t--window : bytes of the first sample of an extension that are learnt: the first <head> and the last <tail> (1 MiB each by default), and\n\t           <blocks> blocks of 4 KiB between them. With \"all\" the whole sample is learnt.\n\tUSE: printrack -l <file to learn> --window <head>:<tail>[:<blocks>]\n");
+        printf("\n\t--top : number of answers given for each file (10 by default, 0 = all of them). The prints that can not reach them are not compared until the end.\n\tUSE: printrack -i <file to identify> --top <answers>\n");
+        printf("\n\t--io : how the files of -i with several files or directories are read: \"uring\" (by default) keeps the reads of many files in flight\n\t       with io_uring, \"threads\" reads each file in a thread of the pool (also used when the system has no io_uring).\n\tUSE: printrack -i <files or directories to identify> --io threads\n");
+        printf("\n\t--no-cache : -i with several files or directories does not use the answers kept in prints/results.cache, by default the files that\n\t             did not change are not read again while the prints and the options are the same.\n\tUSE: printrack -i <files or directories to identify> --no-cache\n");
+        printf("\n\t--stats : when the command ends the calls, time, bytes read and calls to the file system of each phase are shown (in stderr),\n\t          with the segments evaluated and skipped and the time spent with each extension. --stats=json gives them as JSON.\n\tUSE: printrack -i <files to identify> --stats\n");
+        printf("\n\t-c  : compile, all the \"print\" files are compiled in one database (prints/prints.db) that identify loads without parsing. It is updated by -p.\n\tUSE: printrack -c\n");
+        printf("\n\t--embed : the \"print\" files are written as a C++ header (printrack_prints.h). A binary built with it inside identifies without\n\t          the folder \"prints\" (when there is no database nor \"print\" file next to it).\n\tUSE: printrack --embed && g++ -std=c++17 -O2 -pthread -DPRINTRACK_EMBEDDED printrack.cpp -o printrack\n");
         printf("\n");
         break;
     case 0:
@@ -89,6 +127,24 @@ void printHelp(int errCode, string text)
     case 6:
         printf("\nERROR: The folder \"prints\" is empty, the \"print\" files are needed to identify the file format. Use the -h command for more information.\n\n");
         break;
+    case 7:
+        printf("\nERROR: The learn file of the extension \"%s\" is damaged or was made by another version of PrintTracker. Delete it and learn the extension again.\n\n", text.c_str());
+        break;
+    case 8:
+        printf("\nERROR: The print database \"%s\" is damaged or was made by another version of PrintTracker. Use printrack -c to compile it again.\n\n", text.c_str());
+        break;
+    case 9:
+        printf("\nERROR: The socket \"%s\" could not be opened to wait for files to identify.\n\n", text.c_str());
+        break;
+    case 10:
+        printf("\nERROR: The file \"%s\" could not be written (is the disk full?), the old one was not changed.\n\n", text.c_str());
+        break;
+    case 11:
+        printf("\nERROR: The folder \"learns\" doesnt exist, there are no extensions to make their prints. Use the command -l to learn some files first.\n\n");
+        break;
+    case 12:
+        printf("\nERROR: The file \"%s\" already exists and it is not a socket, it is not replaced. Choose another path for the socket.\n\n", text.c_str());
+        break;
     }
     return;
 }
@@ -100,15 +156,19 @@ struct guess
     unsigned int totalPrints;
     unsigned int detectedPrints;
     bool firstHeaderStrike;         // = true if the file to identify coincides in the first track with the print file.
+    float histScore;                // Similarity between the frequencies of the bytes of the file and the print, -1 if they were not compared.
     bool extensionInHeader;         // = true if a mention of the print file extension is found in the file to be identified, in the first 128 bytes.
     unsigned int extensionDistance; // Here we save the distance from the beginning of the file to the point where we find the extension in the header.
+    unsigned int comparedPrints;    // Segments compared, less than totalPrints if the print was discarded.
+    bool discarded;                 // = true if the print could not reach the answers that are shown, so it was not compared until the end.
 };
 
 struct header
 {
-    int pos;
-    int tam;
+    unsigned long long int pos;
+    unsigned int tam;
     char ori;
+    unsigned int win; // The string can start up to win bytes before or after pos.
 };
 
 struct ans
@@ -120,6 +180,18 @@ struct ans
     bool gotHeader; // =true if we detect a header that matches the header in the file.
 };
 
+const unsigned int histSections = 4; // Sections of a file with their own frequencies of bytes: the whole file and each third.
+
+struct target
+{
+    unsigned long long int size;
+    vector<unsigned char> head; // The first bytes of the file, as many as the straight segments of the prints need.
+    vector<unsigned char> tail; // The last bytes of the file, as many as the inverted segments of the prints need.
+    bool hasHist = false;
+    unsigned int histCount = histSections; // Sections measured, only the whole file (1) when it is read from a stream.
+    float hist[histSections][256];         // Frequencies of the bytes of the file.
+};
+
 //UTILITY FUNCTIONS:
 unsigned long long int filesize(FILE *archivo)
 {
@@ -174,411 +246,3516 @@ string nombre(string filename)
     return retMe;
 }
 
-string parseUntil(FILE *fileToParse, char endToken)
+bool compareAnswers(const ans &a, const ans &b)
 {
-    string retMe;
-    char byte;
-    fread(&byte, 1, 1, fileToParse);
-    while (byte != endToken && !feof(fileToParse))
+    if (a.weight != b.weight)
+        return a.weight > b.weight;
+    return a.ext < b.ext;
+}
+
+//=false if the bytes could not be written whole in the file (the disk is full...), then the file is removed.
+bool writeBytes(string path, const string &bytes)
+{
+    FILE *output = fopen(path.c_str(), "wb");
+    if (output == NULL)
+        return false;
+    bool written = fwrite(bytes.data(), 1, bytes.size(), output) == bytes.size();
+    if (fclose(output) != 0 || !written)
     {
-        retMe += byte;
-        fread(&byte, 1, 1, fileToParse);
+        remove(path.c_str());
+        return false;
     }
-    return retMe;
+    return true;
 }
 
-bool compareAnswers(const ans &a, const ans &b)
+//STATISTICS:
+/* With --stats every phase of learn, print and identify counts its calls, its time, the bytes that it reads and its calls to the file
+* system, and the comparisons count the segments evaluated and the segments skipped because their print could not enter the best
+* answers. They are shown in stderr at the end of the command, or as JSON with --stats=json (the server answers them to the line STATS).
+* The time of a phase includes the phases that it calls (learn includes its frequencies) and with threads it is the sum of all of them,
+* the bytes and the calls to the file system are counted only in the innermost phase.
+* When the statistics are disabled every counting point is only a check of statsMode.
+*/
+enum statPhase
+{
+    statLearn,
+    statPrint,
+    statLoad,
+    statScan,
+    statTarget,
+    statHist,
+    statCompare,
+    statPhases
+};
+const char *const statNames[statPhases] = {"learn", "print", "load", "scan", "target", "histogram", "compare"};
+
+struct phaseCounters
+{
+    atomic<unsigned long long int> calls{0}, nanos{0}, bytes{0}, ioCalls{0};
+};
+
+struct extensionCounters
+{
+    unsigned long long int evaluations = 0, segments = 0, nanos = 0;
+};
+
+int statsMode = 0; // 0 = disabled, 1 = text, 2 = JSON.
+phaseCounters phaseStats[statPhases];
+atomic<unsigned long long int> segmentsEvaluated{0}, segmentsSkipped{0}, printsEvaluated{0}, printsSkipped{0};
+mutex extensionStatsLock;
+map<string, extensionCounters> extensionStats;
+const auto statsStart = chrono::steady_clock::now();
+thread_local statPhase currentPhase = statPhases; // Phase that is running in this thread, statPhases = none.
+
+void statAdd(atomic<unsigned long long int> &counter, unsigned long long int value)
 {
-    return a.weight > b.weight;
+    counter.fetch_add(value, memory_order_relaxed);
 }
 
-//CORE FUNCTIONS:
-void learn(string filename)
+unsigned long long int statNanos(chrono::steady_clock::time_point since)
 {
-    char byte;  //Auxiliary, used to read the input file.
-    char byte2; //Auxiliary, used to read output files.
-    FILE *input = fopen(filename.c_str(), "rb");
-    //Indices para leer los archivos cuando hay quilombo:
-    unsigned long long int index = 1;
-    unsigned long long int endIndex = filesize(input);
+    return chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - since).count();
+}
 
-    //We check if the directory "learns" exists, if not we create it:
-    if (checkFile("learns") == -1)
+//Counts the time of a phase while it lives, the reads of this thread meanwhile are counted in the phase.
+struct phaseTimer
+{
+    statPhase phase, outer;
+    chrono::steady_clock::time_point start;
+
+    explicit phaseTimer(statPhase p) : phase(p), outer(currentPhase)
     {
-        mkdir("learns");
+        if (statsMode == 0)
+            return;
+        currentPhase = phase;
+        start = chrono::steady_clock::now();
     }
-    //Routes for the "learn" files:
-    string filepathDer = "learns\\" + extension(filename) + ".learn1";
-    string filepathInv = "learns\\" + extension(filename) + ".learn2";
-    //We check if we have to make the "learn" files or if they were created previously:
-    if (checkFile(filepathDer) == -1 || checkFile(filepathInv) == -1)
-    {                                                       //The extension is new and the files must be created:
-        FILE *outputDer = fopen(filepathDer.c_str(), "wb"); //File reading straight.
-        FILE *outputInv = fopen(filepathInv.c_str(), "wb"); //File reading reversed.
-        //We copy the file exactly the same:
-        //STRAIGHT:
-        fseek(input, 0, SEEK_SET);
-        fread(&byte, 1, 1, input);
-        while (!feof(input))
-        {
-            fprintf(outputDer, "%c", byte);
-            fread(&byte, 1, 1, input);
-        }
-        //INVERTED:
-        while (index <= endIndex)
-        {
-            fseek(input, endIndex - index, SEEK_SET);
-            fread(&byte, 1, 1, input);
-            fprintf(outputInv, "%c", byte);
-            index++;
-        }
-        fclose(outputDer);
-        fclose(outputInv);
+
+    ~phaseTimer()
+    {
+        if (statsMode == 0)
+            return;
+        statAdd(phaseStats[phase].calls, 1);
+        statAdd(phaseStats[phase].nanos, statNanos(start));
+        currentPhase = outer;
     }
-    else
-    {                                                        //We know the extension and the file must be modified:
-        FILE *outputDer = fopen(filepathDer.c_str(), "rb+"); //File reading straight.
-        FILE *outputInv = fopen(filepathInv.c_str(), "rb+"); //File reading reversed.
-        //Modifying the files:
-        //STRAIGHT:
-        rewind(input);
-        rewind(outputDer);
-        while (!feof(outputDer) && !feof(input))
-        {
-            fread(&byte, 1, 1, input);
-            fread(&byte2, 1, 1, outputDer);
-            if (byte2 == ' ')
-                continue;
-            if (byte != byte2)
-            {
-                if (ftell(outputDer) != 0)
-                    fseek(outputDer, -1L, SEEK_CUR);
-                else
-                    rewind(outputDer);
-                fprintf(outputDer, " ");
-                fseek(outputDer, 0L, SEEK_CUR);
-            }
-        }
-        //INVERTED:
-        rewind(input);
-        rewind(outputInv);
-        while (!feof(outputInv) && index <= endIndex)
-        {
-            fseek(input, endIndex - index, SEEK_SET);
-            fread(&byte, 1, 1, input);
-            fread(&byte2, 1, 1, outputInv);
-            if (byte2 == ' ')
-                continue;
-            if (byte != byte2)
-            {
-                if (ftell(outputInv) != 0)
-                    fseek(outputInv, -1L, SEEK_CUR);
-                else
-                    rewind(outputInv);
-                fprintf(outputInv, " ");
-                fseek(outputInv, 0L, SEEK_CUR);
-            }
-            index++;
-        }
-        fclose(outputDer);
-        fclose(outputInv);
+};
+
+//A call to the file system of the current phase that reads the indicated bytes.
+void statIO(unsigned long long int bytes)
+{
+    if (statsMode == 0 || currentPhase == statPhases)
+        return;
+    statAdd(phaseStats[currentPhase].ioCalls, 1);
+    statAdd(phaseStats[currentPhase].bytes, bytes);
+}
+
+size_t countedRead(void *out, size_t len, FILE *source)
+{
+    size_t readed = fread(out, 1, len, source);
+    statIO(readed);
+    return readed;
+}
+
+int countedSeek(FILE *source, unsigned long long int offset)
+{
+    statIO(0);
+    return fseeko(source, offset, SEEK_SET);
+}
+
+string statsJson()
+{
+    string json = "{\"wall_ns\":" + to_string(statNanos(statsStart)) + ",\"phases\":{";
+    for (unsigned int p = 0; p < statPhases; p++)
+    {
+        json += string((p > 0) ? "," : "") + "\"" + statNames[p] + "\":{\"calls\":" + to_string(phaseStats[p].calls.load()) +
+                ",\"ns\":" + to_string(phaseStats[p].nanos.load()) + ",\"bytes_read\":" + to_string(phaseStats[p].bytes.load()) +
+                ",\"io_calls\":" + to_string(phaseStats[p].ioCalls.load()) + "}";
     }
-    fclose(input);
-    return;
+    json += "},\"segments\":{\"evaluated\":" + to_string(segmentsEvaluated.load()) + ",\"skipped\":" + to_string(segmentsSkipped.load()) +
+            "},\"prints\":{\"evaluated\":" + to_string(printsEvaluated.load()) + ",\"skipped\":" + to_string(printsSkipped.load()) + "},\"extensions\":{";
+    lock_guard<mutex> guard(extensionStatsLock);
+    for (auto it = extensionStats.begin(); it != extensionStats.end(); it++)
+    {
+        //The extensions are names of files, only the quotes and the backslashes must be escaped:
+        string name;
+        for (unsigned int i = 0; i < it->first.size(); i++)
+            name += (it->first[i] == '"' || it->first[i] == '\\') ? "\\" + string(1, it->first[i]) : string(1, it->first[i]);
+        json += string((it != extensionStats.begin()) ? "," : "") + "\"" + name + "\":{\"evaluations\":" + to_string(it->second.evaluations) +
+                ",\"segments\":" + to_string(it->second.segments) + ",\"ns\":" + to_string(it->second.nanos) + "}";
+    }
+    return json + "}}";
 }
 
-void generatePrint(string ext)
+void printStats()
 {
-    //We check if the "prints" directory exists, if not we create it:
-    if (checkFile("prints") == -1)
+    if (statsMode == 2)
     {
-        mkdir("prints");
+        fprintf(stderr, "%s\n", statsJson().c_str());
+        return;
     }
-    //We check if the extension that the user gave to us is already learnt:
-    string learn1path = "learns/" + ext + ".learn1";
-    string learn2path = "learns/" + ext + ".learn2";
-    if (!(checkFile(learn1path) == 0 && checkFile(learn2path) == 0))
-        printHelp(4, ext);
-    else
-    { //If the extension was learned:
-        string printPath = "prints/" + ext + ".print";
-        FILE *printFile = fopen(printPath.c_str(), "wb");
-        FILE *learn1File = fopen(learn1path.c_str(), "rb");
-        FILE *learn2File = fopen(learn2path.c_str(), "rb");
-
-        char byte;
-        unsigned long long int charChainIndex;
-        vector<char> charChainPrint;
-        //We read the files:
-        //STRAIGHT:
-        fread(&byte, 1, 1, learn1File);
-        while (!feof(learn1File))
-        {
-            if (byte != ' ')
-            {
-                charChainIndex = ftell(learn1File) - 1;
-                while (byte != ' ')
-                {
-                    charChainPrint.push_back(byte);
-                    fread(&byte, 1, 1, learn1File);
-                }
-                if (charChainPrint.size() > 0)
-                {
-                    fprintf(printFile, "<%llu|%u|d>", charChainIndex, (unsigned)charChainPrint.size());
-                    for (unsigned int i = 0; i < charChainPrint.size(); i++)
-                    {
-                        fprintf(printFile, "%c", charChainPrint[i]);
-                    }
-                }
-                charChainPrint.clear();
-            }
-            else
-                fread(&byte, 1, 1, learn1File);
-        }
-        fclose(learn1File);
-        charChainPrint.clear();
-        //INVERTED:
-        fread(&byte, 1, 1, learn2File);
-        while (!feof(learn2File))
-        {
-            if (byte != ' ')
-            {
-                charChainIndex = ftell(learn2File) - 1;
-                while (byte != ' ')
-                {
-                    charChainPrint.push_back(byte);
-                    fread(&byte, 1, 1, learn2File);
-                }
-                if (charChainPrint.size() > 0)
-                {
-                    fprintf(printFile, "<%llu|%u|i>", charChainIndex + (unsigned)charChainPrint.size(), (unsigned)charChainPrint.size());
-                    for (unsigned int i = charChainPrint.size() - 1; i > 0; i--)
-                    {
-                        fprintf(printFile, "%c", charChainPrint[i]);
-                    }
-                    fprintf(printFile, "%c", charChainPrint[0]);
-                }
-                charChainPrint.clear();
-            }
-            else
-                fread(&byte, 1, 1, learn2File);
-        }
-        fclose(learn2File);
-        fclose(printFile);
+    fprintf(stderr, "\nStatistics (wall time %.3f ms): \n \n Phase      |  Calls |   Time (ms) |    Bytes read |  I/O calls \n", statNanos(statsStart) / 1e6);
+    for (unsigned int p = 0; p < statPhases; p++)
+    {
+        fprintf(stderr, "  %-10s| %7llu| %12.3f| %14llu| %10llu\n", statNames[p], phaseStats[p].calls.load(), phaseStats[p].nanos.load() / 1e6,
+                phaseStats[p].bytes.load(), phaseStats[p].ioCalls.load());
     }
-    return;
+    fprintf(stderr, "\n Segments: %llu evaluated, %llu skipped. Prints: %llu evaluated, %llu skipped.\n", segmentsEvaluated.load(),
+            segmentsSkipped.load(), printsEvaluated.load(), printsSkipped.load());
+    lock_guard<mutex> guard(extensionStatsLock);
+    if (!extensionStats.empty())
+        fprintf(stderr, "\n Extension | Evaluations |   Segments |   Time (ms) \n");
+    for (auto it = extensionStats.begin(); it != extensionStats.end(); it++)
+    {
+        fprintf(stderr, "  %9s| %12llu| %11llu| %12.3f\n", it->first.c_str(), it->second.evaluations, it->second.segments, it->second.nanos / 1e6);
+    }
+    fprintf(stderr, "\n");
 }
 
-void identify(string filename)
+//COMPARISON KERNEL:
+/* matchLength(a, b, n) = number of bytes at the beginning of a and b that are equal (n if all of them are).
+* It compares 32 bytes at a time with AVX2 or 16 with SSE2, the version is chosen when the program starts depending on the processor.
+*/
+size_t matchLengthScalar(const unsigned char *a, const unsigned char *b, size_t n)
 {
-    vector<guess> guesses;
-    vector<string> prints;
-    string printPath;
-    unsigned int printIndex = 0;
-    unsigned long long int fSize;
-    guess insertor;
-    insertor.ext.clear();
-    insertor.detectedPrints = 0;
-    insertor.totalPrints = 0;
-    insertor.firstHeaderStrike = false;
-    insertor.extensionInHeader = false;
-    header headData;
-    char byte;  //Byte that we read from the print files.
-    char byte2; //Byte that we read from the file that the user gave to us (fileToIdentify).
+    size_t i = 0;
+    while (i < n && a[i] == b[i])
+        i++;
+    return i;
+}
 
-    unsigned int fieldCharCounter = 0;
-    unsigned int auxCounter = 0;
-    bool isOnField = false; //This variable indicates if we are rading from a header or from the info between headers
-    //It changes its value when we have read all the characters that the header indicated, and we wait for the start of another header on that place.
+#if defined(__x86_64__) || defined(__i386__)
+size_t matchLengthSSE2(const unsigned char *a, const unsigned char *b, size_t n)
+{
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16)
+    {
+        __m128i x = _mm_loadu_si128((const __m128i *)(a + i));
+        __m128i y = _mm_loadu_si128((const __m128i *)(b + i));
+        unsigned int equal = _mm_movemask_epi8(_mm_cmpeq_epi8(x, y));
+        if (equal != 0xFFFF)
+            return i + __builtin_ctz(~equal);
+    }
+    return i + matchLengthScalar(a + i, b + i, n - i);
+}
 
-    //We identify, if they exist, all the files inside the "prints" folder:
-    DIR *dir;
-    struct dirent *ent;
-    if ((dir = opendir("prints")) != NULL)
+__attribute__((target("avx2"))) size_t matchLengthAVX2(const unsigned char *a, const unsigned char *b, size_t n)
+{
+    size_t i = 0;
+    for (; i + 32 <= n; i += 32)
     {
-        while ((ent = readdir(dir)) != NULL)
-        {
-            prints.push_back(ent->d_name);
-        }
-        closedir(dir);
+        __m256i x = _mm256_loadu_si256((const __m256i *)(a + i));
+        __m256i y = _mm256_loadu_si256((const __m256i *)(b + i));
+        unsigned int equal = _mm256_movemask_epi8(_mm256_cmpeq_epi8(x, y));
+        if (equal != 0xFFFFFFFF)
+            return i + __builtin_ctz(~equal);
     }
-    else
+    return i + matchLengthSSE2(a + i, b + i, n - i);
+}
+#endif
+
+size_t (*chooseMatchLength())(const unsigned char *, const unsigned char *, size_t)
+{
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2"))
+        return matchLengthAVX2;
+    if (__builtin_cpu_supports("sse2"))
+        return matchLengthSSE2;
+#endif
+    return matchLengthScalar;
+}
+
+size_t (*const matchLength)(const unsigned char *, const unsigned char *, size_t) = chooseMatchLength();
+
+/* maskedMatch(a, b, mask, n) = true if the n bytes of a and b are equal where the mask is 0xFF (where it is 0 any byte is accepted).
+* It is chosen like matchLength.
+*/
+bool maskedMatchScalar(const unsigned char *a, const unsigned char *b, const unsigned char *mask, size_t n)
+{
+    for (size_t i = 0; i < n; i++)
     {
-        printHelp(5, "");
+        if ((a[i] ^ b[i]) & mask[i])
+            return false;
     }
+    return true;
+}
 
-    //We clean the vector of print files of the things we do not need and verify that it is not empty:
-    prints.erase(prints.begin() + 0, prints.begin() + 2);
-    if (prints.size() < 1)
-        printHelp(6, "");
+#if defined(__x86_64__) || defined(__i386__)
+bool maskedMatchSSE2(const unsigned char *a, const unsigned char *b, const unsigned char *mask, size_t n)
+{
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16)
+    {
+        __m128i x = _mm_loadu_si128((const __m128i *)(a + i));
+        __m128i y = _mm_loadu_si128((const __m128i *)(b + i));
+        __m128i m = _mm_loadu_si128((const __m128i *)(mask + i));
+        if (_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_and_si128(_mm_xor_si128(x, y), m), _mm_setzero_si128())) != 0xFFFF)
+            return false;
+    }
+    return maskedMatchScalar(a + i, b + i, mask + i, n - i);
+}
 
-    //Open the file the user gave to us:
-    FILE *fileToIdentify = fopen(filename.c_str(), "rb");
-    fSize = filesize(fileToIdentify);
-
-    //We go through the files in the "prints" folder one by one:
-    while (printIndex < prints.size())
-    {
-        if (extension(prints[printIndex]) == "print")
-        { //If the file has the extension we can read:
-            printPath = "prints\\" + prints[printIndex];
-            FILE *printFile = fopen(printPath.c_str(), "rb");
-            insertor.ext = nombre(prints[printIndex]);
-            //We parse the print file:
-            fread(&byte, 1, 1, printFile);
-            while (!feof(printFile))
-            {
-                //We extract the information from the mini-headers in the print file:
-                if (byte == '<' && !isOnField && !feof(printFile))
-                {
-                    headData.pos = atoi(parseUntil(printFile, '|').c_str());
-                    headData.tam = atoi(parseUntil(printFile, '|').c_str());
-                    fread(&byte, 1, 1, printFile);
-                    headData.ori = byte;
-                    fread(&byte, 1, 1, printFile);
-                    if (byte != '>')
-                        break;
-                    else
-                    {
-                        isOnField = true;
-                        insertor.totalPrints++;
-                    }
-                }
-                //We position the pointer in the file fileToIdentify, to the position indicated by the header of the print file:
-                if (headData.ori == 'd')
-                    fseek(fileToIdentify, headData.pos, SEEK_SET);
-                else if (headData.ori == 'i')
-                    fseek(fileToIdentify, fSize - headData.pos, SEEK_SET);
-                else
-                    break;
-                //We read and compare between both files:
-                if (isOnField)
-                {
-                    fread(&byte, 1, 1, printFile);
-                    fread(&byte2, 1, 1, fileToIdentify);
-                    while (fieldCharCounter <= headData.tam && !feof(printFile))
-                    {
-                        if (byte != byte2)
-                            break;
-                        fieldCharCounter++;
-                        fread(&byte, 1, 1, printFile);
-                        fread(&byte2, 1, 1, fileToIdentify);
-                    }
-                }
-                //If we read everything then it means that they match 100% in that sector, if not we must continue until the next header:
-                if (fieldCharCounter == headData.tam)
-                {
-                    insertor.detectedPrints++;
-                    if (headData.pos == 0 && headData.ori == 'd')
-                        insertor.firstHeaderStrike = true;
-                }
-                else
-                {
-                    auxCounter = fieldCharCounter;
-                    while (auxCounter < headData.tam && !feof(printFile))
-                    {
-                        fread(&byte, 1, 1, printFile);
-                        auxCounter++;
-                    }
-                }
-                fieldCharCounter = 0;
-                isOnField = false;
-            }
-            //We save everything that matched from the print file to the vector before closing it and moving on to the next:
-            guesses.push_back(insertor);
-            insertor.ext.clear();
-            insertor.detectedPrints = 0;
-            insertor.totalPrints = 0;
-            insertor.firstHeaderStrike = false;
-            insertor.extensionInHeader = false;
-            fclose(printFile);
-        }
-        printIndex++;
-    }
-    //We give a result:
-    vector<ans> answers;
-    ans ansInsertor;
-    for (int i = 0; i < guesses.size(); i++)
+__attribute__((target("avx2"))) bool maskedMatchAVX2(const unsigned char *a, const unsigned char *b, const unsigned char *mask, size_t n)
+{
+    size_t i = 0;
+    for (; i + 32 <= n; i += 32)
     {
-        ansInsertor.ext = guesses[i].ext;
-        ansInsertor.gotHeader = guesses[i].firstHeaderStrike;
-        ansInsertor.pcent = guesses[i].detectedPrints * 100 / guesses[i].totalPrints;
-        //if(ansInsertor.pcent > 100) ansInsertor.pcent = 100;
-        ansInsertor.weight = ansInsertor.pcent * guesses[i].detectedPrints;
-        if (ansInsertor.gotHeader)
-            ansInsertor.weight *= 10;
-        ansInsertor.tp = guesses[i].totalPrints;
-        if (ansInsertor.pcent > 0)
-            answers.push_back(ansInsertor);
+        __m256i x = _mm256_loadu_si256((const __m256i *)(a + i));
+        __m256i y = _mm256_loadu_si256((const __m256i *)(b + i));
+        __m256i m = _mm256_loadu_si256((const __m256i *)(mask + i));
+        if (!_mm256_testz_si256(_mm256_xor_si256(x, y), m))
+            return false;
     }
-    sort(answers.begin(), answers.end(), compareAnswers);
-    printf("\nResults: \n \n Extension | Success rate | Total prints \n");
-    if (answers.size() <= 45)
+    return maskedMatchSSE2(a + i, b + i, mask + i, n - i);
+}
+#endif
+
+bool (*chooseMaskedMatch())(const unsigned char *, const unsigned char *, const unsigned char *, size_t)
+{
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2"))
+        return maskedMatchAVX2;
+    if (__builtin_cpu_supports("sse2"))
+        return maskedMatchSSE2;
+#endif
+    return maskedMatchScalar;
+}
+
+bool (*const maskedMatch)(const unsigned char *, const unsigned char *, const unsigned char *, size_t) = chooseMaskedMatch();
+
+//Position of the first appearance of the needle (n bytes) in the haystack, hayLen if it does not appear. The candidates are the positions
+//where the first and the last bytes of the needle match, 16 positions are checked at a time with SSE2.
+size_t findSegment(const unsigned char *hay, size_t hayLen, const unsigned char *needle, size_t n)
+{
+    if (n == 0 || n > hayLen)
+        return (n == 0) ? 0 : hayLen;
+    size_t last = hayLen - n; //Last position where the needle can start.
+    size_t i = 0;
+#if defined(__x86_64__) || defined(__i386__)
+    __m128i firstByte = _mm_set1_epi8(needle[0]);
+    __m128i lastByte = _mm_set1_epi8(needle[n - 1]);
+    for (; i + 15 <= last; i += 16)
     {
-        for (int i = 0; i < answers.size(); i++)
+        __m128i a = _mm_loadu_si128((const __m128i *)(hay + i));
+        __m128i b = _mm_loadu_si128((const __m128i *)(hay + i + n - 1));
+        unsigned int candidates = _mm_movemask_epi8(_mm_and_si128(_mm_cmpeq_epi8(a, firstByte), _mm_cmpeq_epi8(b, lastByte)));
+        while (candidates != 0)
         {
-            if (answers[i].gotHeader)
-                printf("  %10s| %22f| %15d   <= A header matching this extension was detected.\n", answers[i].ext.c_str(), answers[i].pcent, answers[i].tp);
-            else
-                printf("  %10s| %22f| %15d\n", answers[i].ext.c_str(), answers[i].pcent, answers[i].tp);
+            unsigned int k = __builtin_ctz(candidates);
+            if (matchLength(hay + i + k, needle, n) == n)
+                return i + k;
+            candidates &= candidates - 1;
         }
     }
-    else
+#endif
+    for (; i <= last; i++)
     {
-        int auxC;
-        for (int i = 0; i < answers.size() && i <= 45; i++)
-        {
-            if (answers[i].gotHeader)
-                printf("  %10s| %22f| %15d   <= A header matching this extension was detected.\n", answers[i].ext.c_str(), answers[i].pcent, answers[i].tp);
-            else
-                printf("  %10s| %22f| %15d\n", answers[i].ext.c_str(), answers[i].pcent, answers[i].tp);
-            auxC = i;
-        }
-        printf(" %d Other possible extensions ...", answers.size() - auxC);
+        if (hay[i] == needle[0] && matchLength(hay + i, needle, n) == n)
+            return i;
     }
-    printf("\n\n");
-    return;
+    return hayLen;
 }
 
-int main(int argc, char *argv[])
+//THREAD POOL:
+/* Work stealing pool: every worker has its own queue, it takes the tasks from the back of it and when it is empty it steals from the
+* front of the queues of the others. The tasks can add more tasks (they go to the queue of the worker that runs them). A worker that
+* finds every queue empty sleeps until a task is added or the last one ends.
+*/
+class workPool
 {
-    //We review the command that the user gives us:
-    if (argc <= 2)
+    struct workQueue
     {
-        printHelp(-1, "");
-        return 0;
-    }
-    if (argc == 3)
+        mutex lock;
+        deque<function<void()>> tasks;
+    };
+    deque<workQueue> queues;
+    atomic<unsigned long long int> pending{0}; // Tasks not ended (in the queues or running).
+    atomic<unsigned long long int> queued{0};  // Tasks in the queues.
+    atomic<unsigned int> next{0};
+    mutex idleLock;
+    condition_variable idle;
+    static thread_local int self; // Queue of the worker that runs in this thread, -1 outside of the pool.
+
+    bool take(unsigned int q, bool back, function<void()> &task)
     {
-        if (string(argv[1]) == "-l")
+        lock_guard<mutex> guard(queues[q].lock);
+        if (queues[q].tasks.empty())
+            return false;
+        if (back)
         {
-            if (checkFile(argv[2]) == 0)
-            {
-                learn(string(argv[2]));
-            }
-            else
-                printHelp(2, argv[2]);
+            task = move(queues[q].tasks.back());
+            queues[q].tasks.pop_back();
         }
-        else if (string(argv[1]) == "-p")
+        else
         {
-            generatePrint(string(argv[2]));
+            task = move(queues[q].tasks.front());
+            queues[q].tasks.pop_front();
         }
-        else if (string(argv[1]) == "-i")
+        queued--;
+        return true;
+    }
+
+    void wake(bool all)
+    {
+        lock_guard<mutex> guard(idleLock);
+        if (all)
+            idle.notify_all();
+        else
+            idle.notify_one();
+    }
+
+    void work(unsigned int q)
+    {
+        function<void()> task;
+        self = q;
+        while (pending > 0)
         {
-            if (checkFile(argv[2]) == 0)
+            bool got = take(q, true, task);
+            for (unsigned int i = 1; !got && i < queues.size(); i++)
+                got = take((q + i) % queues.size(), false, task);
+            if (!got)
             {
-                identify(string(argv[2]));
+                unique_lock<mutex> guard(idleLock);
+                idle.wait(guard, [this]
+                          { return pending == 0 || queued > 0; });
+                continue;
             }
+            task();
+            if (--pending == 0)
+                wake(true);
+        }
+        self = -1;
+    }
+
+public:
+    explicit workPool(unsigned int threads = thread::hardware_concurrency())
+    {
+        queues.resize(max(threads, 1u));
+    }
+
+    unsigned int size()
+    {
+        return queues.size();
+    }
+
+    void submit(function<void()> task)
+    {
+        unsigned int q = (self >= 0) ? self : next++ % queues.size();
+        pending++;
+        {
+            lock_guard<mutex> guard(queues[q].lock);
+            queues[q].tasks.push_back(move(task));
+        }
+        queued++;
+        wake(false);
+    }
+
+    //Runs until every task, including the ones added by other tasks, is done.
+    void run()
+    {
+        vector<thread> workers;
+        for (unsigned int q = 1; q < queues.size(); q++)
+            workers.emplace_back(&workPool::work, this, q);
+        work(0);
+        for (unsigned int i = 0; i < workers.size(); i++)
+            workers[i].join();
+    }
+};
+thread_local int workPool::self = -1;
+
+//ASYNCHRONOUS READS:
+/* io_uring ring, used with its system calls (there is no library): the reads are put in the submission queue, the kernel does many of
+* them at the same time and leaves their results in the completion queue. Each operation (an open or a read) takes back the number that
+* it was given (tag).
+* Without io_uring (another system, an old kernel, or it is not allowed) open() fails and the reads are done by the thread pool.
+*/
+bool useRing = true; //The bulk identify reads the files with io_uring (--io uring, by default) or with the thread pool (--io threads).
+
+#ifdef PRINTRACK_URING
+class ioRing
+{
+    int fd = -1;
+    unsigned int *sqHead, *sqTail, *sqMask, *sqArray, *cqHead, *cqTail, *cqMask;
+    io_uring_sqe *sqes;
+    io_uring_cqe *cqes;
+    void *sqMap = MAP_FAILED, *cqMap = MAP_FAILED, *sqesMap = MAP_FAILED;
+    size_t sqSize = 0, cqSize = 0, sqesSize = 0;
+    unsigned int queued = 0;   // Reads in the submission queue that the kernel has not taken.
+    unsigned int inFlight = 0; // Reads submitted whose completion has not been taken.
+    unsigned int capacity = 0; // Reads that can be in flight without overflowing the completion queue.
+
+public:
+    bool open(unsigned int entries)
+    {
+        io_uring_params params = {};
+        fd = syscall(__NR_io_uring_setup, entries, &params);
+        //The opens and the reads of the ring came with Linux 5.6, the kernels from 5.7 have IORING_FEAT_FAST_POLL:
+        if (fd < 0 || !(params.features & IORING_FEAT_FAST_POLL))
+            return false;
+        sqSize = params.sq_off.array + params.sq_entries * sizeof(unsigned int);
+        cqSize = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+        sqesSize = params.sq_entries * sizeof(io_uring_sqe);
+        sqMap = mmap(NULL, sqSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+        cqMap = mmap(NULL, cqSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_CQ_RING);
+        sqesMap = mmap(NULL, sqesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES);
+        if (sqMap == MAP_FAILED || cqMap == MAP_FAILED || sqesMap == MAP_FAILED)
+            return false;
+        char *sq = (char *)sqMap, *cq = (char *)cqMap;
+        sqHead = (unsigned int *)(sq + params.sq_off.head);
+        sqTail = (unsigned int *)(sq + params.sq_off.tail);
+        sqMask = (unsigned int *)(sq + params.sq_off.ring_mask);
+        sqArray = (unsigned int *)(sq + params.sq_off.array);
+        cqHead = (unsigned int *)(cq + params.cq_off.head);
+        cqTail = (unsigned int *)(cq + params.cq_off.tail);
+        cqMask = (unsigned int *)(cq + params.cq_off.ring_mask);
+        cqes = (io_uring_cqe *)(cq + params.cq_off.cqes);
+        sqes = (io_uring_sqe *)sqesMap;
+        capacity = min(params.sq_entries, params.cq_entries);
+        return true;
+    }
+
+    ~ioRing()
+    {
+        if (sqMap != MAP_FAILED)
+            munmap(sqMap, sqSize);
+        if (cqMap != MAP_FAILED)
+            munmap(cqMap, cqSize);
+        if (sqesMap != MAP_FAILED)
+            munmap(sqesMap, sqesSize);
+        if (fd >= 0)
+            close(fd);
+    }
+
+    //A new entry of the submission queue, NULL if the ring is full and the operation must wait for some completions.
+    io_uring_sqe *entry(unsigned char opcode, unsigned long long int tag)
+    {
+        if (inFlight >= capacity)
+            return NULL;
+        unsigned int tail = *sqTail;
+        unsigned int index = tail & *sqMask;
+        io_uring_sqe *sqe = &sqes[index];
+        memset(sqe, 0, sizeof(*sqe));
+        sqe->opcode = opcode;
+        sqe->user_data = tag;
+        sqArray[index] = index;
+        __atomic_store_n(sqTail, tail + 1, __ATOMIC_RELEASE);
+        queued++;
+        inFlight++;
+        return sqe;
+    }
+
+    //The result of the open is the descriptor of the file.
+    bool openFile(const char *path, unsigned long long int tag)
+    {
+        io_uring_sqe *sqe = entry(IORING_OP_OPENAT, tag);
+        if (sqe == NULL)
+            return false;
+        sqe->fd = AT_FDCWD;
+        sqe->addr = (unsigned long long int)path;
+        sqe->open_flags = O_RDONLY | O_CLOEXEC;
+        return true;
+    }
+
+    bool read(int file, void *out, unsigned int len, unsigned long long int offset, unsigned long long int tag)
+    {
+        io_uring_sqe *sqe = entry(IORING_OP_READ, tag);
+        if (sqe == NULL)
+            return false;
+        sqe->fd = file;
+        sqe->addr = (unsigned long long int)out;
+        sqe->len = len;
+        sqe->off = offset;
+        return true;
+    }
+
+    unsigned int pending()
+    {
+        return inFlight;
+    }
+
+    //The queued reads are given to the kernel, waiting until at least one of them is completed if wait = true.
+    bool submit(bool wait)
+    {
+        int done = syscall(__NR_io_uring_enter, fd, queued, wait ? 1 : 0, wait ? IORING_ENTER_GETEVENTS : 0, NULL, 0);
+        if (done < 0)
+            return errno == EINTR || errno == EAGAIN || errno == EBUSY;
+        queued -= done;
+        return true;
+    }
+
+    //=false if nothing is completed. result is the result of the operation (or -errno).
+    bool complete(unsigned long long int &tag, int &result)
+    {
+        unsigned int head = *cqHead;
+        if (head == __atomic_load_n(cqTail, __ATOMIC_ACQUIRE))
+            return false;
+        tag = cqes[head & *cqMask].user_data;
+        result = cqes[head & *cqMask].res;
+        __atomic_store_n(cqHead, head + 1, __ATOMIC_RELEASE);
+        inFlight--;
+        return true;
+    }
+};
+#else
+class ioRing
+{
+public:
+    bool open(unsigned int entries) { return false; }
+    bool openFile(const char *path, unsigned long long int tag) { return false; }
+    bool read(int file, void *out, unsigned int len, unsigned long long int offset, unsigned long long int tag) { return false; }
+    unsigned int pending() { return 0; }
+    bool submit(bool wait) { return false; }
+    bool complete(unsigned long long int &tag, int &result) { return false; }
+};
+#endif
+
+//LEARN STATE:
+/* The "learn" file of an extension (learns/<ext>.learn) keeps the bytes of the first sample learnt (the reference) that are still alive.
+* Every position is relative to the reference. The straight view compares the samples aligned at their beginning and the inverted view
+* compares them aligned at their end, each view keeps its surviving bytes as a list of runs [start, start + len). Only the union of both
+* views (the extents) is stored, so a surviving byte is saved once even if both views keep it.
+* Format (numbers in the byte order of the machine):
+* "PTLS" | version (u32) | samples learnt (u64) | size of the reference (u64)
+* | number of extents (u32) | extents | number of straight runs (u32) | runs | number of inverted runs (u32) | runs
+* | sum of the frequencies of the bytes of every sample (histSections x 256 doubles) | the bytes of every extent, one after the other. (Extents and runs are stored as start (u64), len (u64), win (u32)).
+* A run with win > 0 is a floating run: in some samples its bytes were found up to win bytes away from its position.
+* Only a window of the first sample is learnt (--window): the straight view starts with its first learnHead bytes (and learnInterior
+* blocks spread between the head and the tail) and the inverted view with its last learnTail bytes, so the size of the "learn" file
+* and the bytes read from every sample do not grow with the size of the samples.
+*/
+const char learnMagic[4] = {'P', 'T', 'L', 'S'};
+const unsigned int learnVersion = 3;
+const unsigned int learnBlock = 1 << 20; //Size of the blocks used to stream the files in learn (1 MiB).
+const unsigned int learnGap = 1 << 12;   //Parts of a sample closer than this are read together.
+const unsigned int learnMemory = 1 << 26; //Most bytes of a reference that learn and print load in memory (64 MiB).
+const unsigned int interiorBlock = 1 << 12; //Size of the blocks of the interior of the first sample that are learnt.
+unsigned long long int learnHead = 1 << 20; //Bytes from the beginning of the first sample that are learnt (--window), 1 MiB by default.
+unsigned long long int learnTail = 1 << 20; //Bytes from the end of the first sample that are learnt (--window), 1 MiB by default.
+unsigned int learnInterior = 0;             //Blocks between the head and the tail of the first sample that are learnt (--window).
+const unsigned int floatMin = 4;         //Shortest run that can float, the shorter ones would be found anywhere.
+const unsigned int floatMax = 4096;      //Longest run that is searched when it is not in its position.
+const unsigned int floatWindow = 16;     //How many bytes a floating run can move from its position.
+const unsigned int floatDiscover = 8;    //Shortest string that becomes a new floating run.
+const unsigned int floatScan = 1 << 16;  //Bytes from the beginning (straight view) or the end (inverted view) where new floating runs are searched.
+
+struct learnSpan
+{
+    unsigned long long int start;
+    unsigned long long int len;
+    unsigned int win;
+};
+
+struct learnState
+{
+    unsigned long long int samples;
+    unsigned long long int refSize;
+    vector<learnSpan> extents;
+    vector<unsigned long long int> extentData; // Position in the source file of the first byte of each extent.
+    vector<learnSpan> runs[2];                 // [0] = straight view, [1] = inverted view.
+    double hist[histSections][256];            // Sum of the frequencies of the bytes of every sample.
+    vector<char> loaded;                       // The bytes of every extent, one after the other, if they were loaded in memory.
+};
+
+template <typename T>
+void putValue(string &buffer, T value)
+{
+    buffer.append((const char *)&value, sizeof(T));
+}
+
+template <typename T>
+bool getValue(FILE *source, T &value)
+{
+    return fread(&value, sizeof(T), 1, source) == 1;
+}
+
+bool readSpans(FILE *source, vector<learnSpan> &spans)
+{
+    unsigned int count;
+    if (!getValue(source, count))
+        return false;
+    spans.resize(count);
+    for (unsigned int i = 0; i < count; i++)
+    {
+        if (!getValue(source, spans[i].start) || !getValue(source, spans[i].len) || !getValue(source, spans[i].win))
+            return false;
+    }
+    return true;
+}
+
+void writeSpans(string &buffer, const vector<learnSpan> &spans)
+{
+    putValue(buffer, (unsigned int)spans.size());
+    for (unsigned int i = 0; i < spans.size(); i++)
+    {
+        putValue(buffer, spans[i].start);
+        putValue(buffer, spans[i].len);
+        putValue(buffer, spans[i].win);
+    }
+}
+
+//Reads the header of a "learn" file, leaves the state ready to read the bytes of the reference from that file. =false if the file is not valid.
+bool readLearnState(FILE *learnFile, learnState &state)
+{
+    char magic[4];
+    unsigned int version;
+    unsigned long long int data;
+    if (fread(magic, 1, 4, learnFile) != 4 || memcmp(magic, learnMagic, 4) != 0)
+        return false;
+    if (!getValue(learnFile, version) || version != learnVersion)
+        return false;
+    if (!getValue(learnFile, state.samples) || !getValue(learnFile, state.refSize))
+        return false;
+    if (!readSpans(learnFile, state.extents) || !readSpans(learnFile, state.runs[0]) || !readSpans(learnFile, state.runs[1]))
+        return false;
+    if (fread(state.hist, sizeof(state.hist), 1, learnFile) != 1)
+        return false;
+    data = ftell(learnFile);
+    state.extentData.clear();
+    for (unsigned int i = 0; i < state.extents.size(); i++)
+    {
+        state.extentData.push_back(data);
+        data += state.extents[i].len;
+    }
+    return true;
+}
+
+//Loads the bytes of the reference in memory, so they can be read by several threads at the same time and without a seek for
+//each run. If there are more than limit bytes they are not loaded (and they are read from the file).
+bool loadReference(FILE *learnFile, learnState &state, unsigned long long int limit = ~0ULL)
+{
+    unsigned long long int total = 0;
+    for (unsigned int i = 0; i < state.extents.size(); i++)
+        total += state.extents[i].len;
+    if (total == 0 || total > limit)
+        return true;
+    state.loaded.resize(total);
+    countedSeek(learnFile, state.extentData[0]);
+    return countedRead(state.loaded.data(), total, learnFile) == total;
+}
+
+//Reads the bytes [start, start + len) of the reference, they must be inside one of the extents of the state. If the reference
+//was loaded the bytes are taken from memory, if not from the source. =false if the source could not give all of them.
+bool readReference(FILE *source, const learnState &state, unsigned long long int start, unsigned long long int len, char *out)
+{
+    unsigned int e = upper_bound(state.extents.begin(), state.extents.end(), start, [](unsigned long long int pos, const learnSpan &ext)
+                                 { return pos < ext.start; }) -
+                     state.extents.begin() - 1;
+    if (!state.loaded.empty())
+    {
+        memcpy(out, state.loaded.data() + (state.extentData[e] - state.extentData[0]) + (start - state.extents[e].start), len);
+        return true;
+    }
+    countedSeek(source, state.extentData[e] + start - state.extents[e].start);
+    return countedRead(out, len, source) == len;
+}
+
+//Union of two sorted lists of runs.
+vector<learnSpan> joinSpans(const vector<learnSpan> &a, const vector<learnSpan> &b)
+{
+    vector<learnSpan> all, retMe;
+    merge(a.begin(), a.end(), b.begin(), b.end(), back_inserter(all), [](const learnSpan &x, const learnSpan &y)
+          { return x.start < y.start; });
+    for (unsigned int i = 0; i < all.size(); i++)
+    {
+        if (!retMe.empty() && all[i].start <= retMe.back().start + retMe.back().len)
+            retMe.back().len = max(retMe.back().len, all[i].start + all[i].len - retMe.back().start);
+        else
+            retMe.push_back({all[i].start, all[i].len, 0});
+    }
+    return retMe;
+}
+
+//Intersection of two sorted lists of runs of the same reference, every piece keeps the biggest window of the two runs that make it.
+vector<learnSpan> meetSpans(const vector<learnSpan> &a, const vector<learnSpan> &b)
+{
+    vector<learnSpan> retMe;
+    for (unsigned int i = 0, j = 0; i < a.size() && j < b.size();)
+    {
+        unsigned long long int from = max(a[i].start, b[j].start);
+        unsigned long long int to = min(a[i].start + a[i].len, b[j].start + b[j].len);
+        if (from < to)
+            retMe.push_back({from, to - from, max(a[i].win, b[j].win)});
+        if (a[i].start + a[i].len < b[j].start + b[j].len)
+            i++;
+        else
+            j++;
+    }
+    return retMe;
+}
+
+//Keeps the part of the runs that is inside [lo, hi) and outside of the dead spans (both lists sorted).
+vector<learnSpan> cutSpans(const vector<learnSpan> &runs, unsigned long long int lo, unsigned long long int hi, const vector<learnSpan> &dead)
+{
+    vector<learnSpan> retMe;
+    unsigned int d = 0;
+    for (unsigned int i = 0; i < runs.size(); i++)
+    {
+        unsigned long long int from = max(runs[i].start, lo);
+        unsigned long long int to = min(runs[i].start + runs[i].len, hi);
+        while (from < to)
+        {
+            while (d < dead.size() && dead[d].start + dead[d].len <= from)
+                d++;
+            unsigned long long int until = (d < dead.size()) ? min(to, dead[d].start) : to;
+            if (until > from)
+                retMe.push_back({from, until - from, runs[i].win});
+            if (d >= dead.size() || dead[d].start >= to)
+                break;
+            from = dead[d].start + dead[d].len;
+        }
+    }
+    return retMe;
+}
+
+//Writes the state in the "learn" file, the bytes of the extents are copied from source (described by sourceState). =false if the
+//new file could not be written whole, then the old one is not changed.
+bool writeLearnState(string learnPath, const learnState &state, FILE *source, const learnState &sourceState)
+{
+    string buffer(learnMagic, 4);
+    vector<char> block(learnBlock);
+    putValue(buffer, learnVersion);
+    putValue(buffer, state.samples);
+    putValue(buffer, state.refSize);
+    writeSpans(buffer, state.extents);
+    writeSpans(buffer, state.runs[0]);
+    writeSpans(buffer, state.runs[1]);
+    buffer.append((const char *)state.hist, sizeof(state.hist));
+    //We write a new file and replace the old one at the end, the source may be the old one:
+    string tmpPath = learnPath + ".tmp";
+    FILE *output = fopen(tmpPath.c_str(), "wb");
+    bool written = output != NULL && fwrite(buffer.data(), 1, buffer.size(), output) == buffer.size();
+    for (unsigned int i = 0; i < state.extents.size() && written; i++)
+    {
+        for (unsigned long long int done = 0; done < state.extents[i].len && written; done += learnBlock)
+        {
+            unsigned long long int len = min((unsigned long long int)learnBlock, state.extents[i].len - done);
+            written = readReference(source, sourceState, state.extents[i].start + done, len, block.data()) &&
+                      fwrite(block.data(), 1, len, output) == len;
+        }
+    }
+    if (output != NULL && fclose(output) != 0)
+        written = false;
+    if (!written || rename(tmpPath.c_str(), learnPath.c_str()) != 0)
+    {
+        remove(tmpPath.c_str());
+        printHelp(10, learnPath);
+        return false;
+    }
+    return true;
+}
+
+//BYTE FREQUENCIES:
+/* The proportion of each byte value in the file is also a footprint, it is measured in sections (histSections): the whole file, the first,
+* the middle and the last third. For big files only histBudget bytes are read, in blocks spread over each third.
+*/
+const unsigned int histBlock = 1 << 16;       //Size of the blocks read when the file is bigger than the budget.
+const unsigned int histWeight = 100;          //Weight that a perfect similarity of frequencies can add to an answer.
+unsigned long long int histBudget = 1 << 20;  //Bytes that can be read from each file to measure the frequencies (--budget), 0 = none.
+unsigned int topAnswers = 10;                 //Answers given for each file (--top), 0 = all of them.
+
+//Adds the bytes to the counters. Four tables are used so consecutive equal bytes do not wait for each other.
+void byteHistogram(const unsigned char *bytes, size_t n, unsigned long long int counts[256])
+{
+    unsigned int tables[4][256] = {};
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4)
+    {
+        unsigned int word;
+        memcpy(&word, bytes + i, 4);
+        tables[0][word & 0xFF]++;
+        tables[1][(word >> 8) & 0xFF]++;
+        tables[2][(word >> 16) & 0xFF]++;
+        tables[3][word >> 24]++;
+    }
+    for (; i < n; i++)
+        tables[0][bytes[i]]++;
+    for (unsigned int b = 0; b < 256; b++)
+        counts[b] += tables[0][b] + tables[1][b] + tables[2][b] + tables[3][b];
+}
+
+//A block of the file that is read to measure the frequencies of its bytes.
+struct histRead
+{
+    unsigned int third;
+    unsigned long long int at;
+    unsigned long long int len;
+};
+
+//Blocks of each third of the file that are read with a budget of bytes: the whole third when it fits in the budget, or else blocks
+//at the same distance from each other.
+vector<histRead> histBlocks(unsigned long long int size, unsigned long long int budget)
+{
+    vector<histRead> blocks;
+    for (unsigned int third = 0; third < 3; third++)
+    {
+        unsigned long long int from = size * third / 3;
+        unsigned long long int len = size * (third + 1) / 3 - from;
+        unsigned long long int share = budget / 3;
+        unsigned long long int blockLen = (len <= share) ? len : min((unsigned long long int)histBlock, share);
+        unsigned long long int count = (len <= share || blockLen == 0) ? 1 : max(share / blockLen, 1ULL);
+        for (unsigned long long int k = 0; k < count && blockLen > 0; k++)
+            blocks.push_back({third, from + ((count == 1) ? 0 : (len - blockLen) * k / (count - 1)), blockLen});
+    }
+    return blocks;
+}
+
+//Frequencies (from 0 to 1) of each section from the counters of the bytes of the thirds (counts[0] is filled with their sum).
+void histFrequencies(unsigned long long int counts[histSections][256], float freq[histSections][256])
+{
+    for (unsigned int b = 0; b < 256; b++)
+        counts[0][b] = counts[1][b] + counts[2][b] + counts[3][b];
+    for (unsigned int s = 0; s < histSections; s++)
+    {
+        unsigned long long int total = 0;
+        for (unsigned int b = 0; b < 256; b++)
+            total += counts[s][b];
+        for (unsigned int b = 0; b < 256; b++)
+            freq[s][b] = (total > 0) ? (float)counts[s][b] / total : 0;
+    }
+}
+
+//Frequencies (from 0 to 1) of the bytes in each section of the file, reading at most budget bytes.
+void fileHistograms(FILE *source, unsigned long long int size, unsigned long long int budget, float freq[histSections][256])
+{
+    phaseTimer timer(statHist);
+    unsigned long long int counts[histSections][256] = {};
+    vector<unsigned char> block(min((unsigned long long int)learnBlock, max(budget, 1ULL)));
+    vector<histRead> blocks = histBlocks(size, budget);
+    for (unsigned int k = 0; k < blocks.size(); k++)
+    {
+        countedSeek(source, blocks[k].at);
+        for (unsigned long long int done = 0; done < blocks[k].len;)
+        {
+            size_t readed = countedRead(block.data(), min((unsigned long long int)block.size(), blocks[k].len - done), source);
+            if (readed == 0)
+                break;
+            byteHistogram(block.data(), readed, counts[1 + blocks[k].third]);
+            done += readed;
+        }
+    }
+    histFrequencies(counts, freq);
+}
+
+//Similarity between two sets of frequencies, from 0 (nothing in common) to 1 (the same): average of 1 - half the distance of each
+//of the first sections.
+float histSimilarity(const float a[histSections][256], const float b[histSections][256], unsigned int sections = histSections)
+{
+    float retMe = 0;
+    for (unsigned int s = 0; s < sections; s++)
+    {
+        float distance = 0;
+        for (unsigned int v = 0; v < 256; v++)
+            distance += fabs(a[s][v] - b[s][v]);
+        retMe += 1 - distance / 2;
+    }
+    return retMe / sections;
+}
+
+//Success rate of a print: segments detected * 100 / total segments.
+unsigned int answerRate(unsigned int detected, unsigned int total)
+{
+    return (total > 0) ? detected * 100 / total : 0;
+}
+
+//Weight of an answer: the success rate by the segments detected, x10 if the main header matched, plus up to histWeight by the similarity of the frequencies.
+//The frequencies add always less than the main header alone gives to the print, so they order the answers but never outweigh a header.
+int answerWeight(unsigned int detected, unsigned int total, bool gotHeader, float histScore)
+{
+    int weight = answerRate(detected, total) * detected;
+    int histCap = min((int)histWeight, (int)answerRate(1, total) * 10 - 1);
+    if (gotHeader)
+        weight *= 10;
+    if (histScore > 0 && histCap > 0)
+        weight += (int)(histScore * histCap + 0.5);
+    return weight;
+}
+
+//PRINT DATABASE:
+/* All the "print" files can be compiled (-c) in one binary file (prints/prints.db) that identify maps in memory and uses as it is, without parsing.
+* When it does not exist the same image is built in memory from the "print" files, and when there are no "print" files a binary built with
+* -DPRINTRACK_EMBEDDED uses the image of printrack_prints.h (made by --embed), compiled inside it. Format (numbers in the byte order of the machine):
+* dbHeader | one dbPrint per extension | all the dbSegment records | byte pool (names of the extensions, bytes and masks of the segments and frequencies).
+*/
+const char dbMagic[4] = {'P', 'T', 'D', 'B'};
+const unsigned int dbVersion = 5;
+const string dbPath = "prints/prints.db";
+const unsigned int prefixLen = 4; // Leading bytes of the main header used to index the prints.
+const unsigned long long int noHist = ~0ULL;
+const unsigned long long int noMask = ~0ULL;
+const string embedPath = "printrack_prints.h";
+
+#ifdef PRINTRACK_EMBEDDED
+#include "printrack_prints.h"
+#endif
+
+struct dbHeader
+{
+    char magic[4];
+    unsigned int version;
+    unsigned int printCount;
+    unsigned int segmentCount;
+    unsigned long long int poolSize;
+    unsigned long long int headWindow; // Bytes from the beginning of a file that the straight segments need.
+    unsigned long long int tailWindow; // Bytes from the end of a file that the inverted segments need.
+};
+
+struct dbPrint
+{
+    unsigned long long int name; // Position of the extension in the byte pool.
+    unsigned int nameLen;
+    unsigned int first; // Index of the first segment of the extension.
+    unsigned int count;
+    unsigned int pad;
+    unsigned long long int hist; // Position in the byte pool of the frequencies of the bytes (histSections x 256 floats), noHist if it has not.
+};
+
+struct dbSegment
+{
+    header head;
+    unsigned long long int data; // Position of the bytes of the segment in the byte pool.
+    unsigned long long int mask; // Position of its mask in the byte pool, noMask if every byte is compared.
+};
+
+//A segment of a "print" file. The mask is empty if every byte is compared.
+struct printSegment
+{
+    header head;
+    string bytes;
+    string mask;
+};
+
+struct printDB
+{
+    const dbHeader *head = NULL;
+    const dbPrint *prints = NULL;
+    const dbSegment *segments = NULL;
+    const unsigned char *pool = NULL;
+    void *map = NULL; // Mapped database, if it was compiled.
+    size_t mapSize = 0;
+    string image; // Database built in memory, if it was not compiled.
+    //Index of the prints by the first bytes of their segment at position 0 (the main header), [L] = segments with L leading bytes:
+    unordered_map<unsigned int, vector<unsigned int>> prefixes[prefixLen + 1];
+    vector<unsigned int> noPrefix; // Prints without a segment at position 0.
+    bool hasHist = false;          // =true if some print has frequencies of bytes.
+    vector<int> maxWeight;         // Highest weight that each print can give to an answer.
+    vector<unsigned int> byWeight; // Prints sorted from the highest to the lowest maxWeight.
+
+    ~printDB()
+    {
+        if (map != NULL)
+            munmap(map, mapSize);
+    }
+};
+
+string printName(const printDB &db, unsigned int p)
+{
+    return string((const char *)db.pool + db.prints[p].name, db.prints[p].nameLen);
+}
+
+//FNV-1a of some bytes.
+unsigned long long int bytesDigest(const unsigned char *bytes, size_t n, unsigned long long int digest = 14695981039346656037ULL)
+{
+    for (size_t i = 0; i < n; i++)
+        digest = (digest ^ bytes[i]) * 1099511628211ULL;
+    return digest;
+}
+
+//Points the tables of the database to the image, =false if it is not a valid database. Every position and count of the tables is
+//checked once here, so the rest of the program can use them without checking (a damaged file can not make it read outside the image).
+bool attachPrints(printDB &db, const char *image, size_t size)
+{
+    db.head = (const dbHeader *)image;
+    if (size < sizeof(dbHeader) || memcmp(db.head->magic, dbMagic, 4) != 0 || db.head->version != dbVersion)
+        return false;
+    size_t tables = sizeof(dbHeader) + db.head->printCount * sizeof(dbPrint) + db.head->segmentCount * sizeof(dbSegment);
+    if (tables > size || size - tables != db.head->poolSize)
+        return false;
+    db.prints = (const dbPrint *)(image + sizeof(dbHeader));
+    db.segments = (const dbSegment *)(db.prints + db.head->printCount);
+    db.pool = (const unsigned char *)(image + tables);
+    unsigned long long int poolSize = db.head->poolSize;
+    auto inPool = [poolSize](unsigned long long int at, unsigned long long int len)
+    {
+        return at <= poolSize && len <= poolSize - at;
+    };
+    for (unsigned int p = 0; p < db.head->printCount; p++)
+    {
+        const dbPrint &print = db.prints[p];
+        if (!inPool(print.name, print.nameLen) || print.first > db.head->segmentCount || print.count > db.head->segmentCount - print.first ||
+            (print.hist != noHist && !inPool(print.hist, histSections * 256 * sizeof(float))))
+            return false;
+    }
+    for (unsigned int s = 0; s < db.head->segmentCount; s++)
+    {
+        const dbSegment &seg = db.segments[s];
+        if (!inPool(seg.data, seg.head.tam) || (seg.mask != noMask && !inPool(seg.mask, seg.head.tam)))
+            return false;
+    }
+    return true;
+}
+
+//Reads the segments and the frequencies of a "print" file (hist is empty if it has not), =false if it can not be opened.
+bool readPrint(string printPath, vector<printSegment> &segments, vector<float> &hist)
+{
+    string content;
+    FILE *printFile = fopen(printPath.c_str(), "rb");
+    if (printFile == NULL)
+        return false;
+    content.resize(filesize(printFile));
+    rewind(printFile);
+    content.resize(countedRead(&content[0], content.size(), printFile));
+    fclose(printFile);
+    //We extract the segments from the mini-headers <pos|tam|ori>, <pos|tam|ori|win> or <pos|tam|ori|win|m>:
+    size_t at = 0;
+    while (at < content.size() && content[at] == '<')
+    {
+        printSegment seg = {};
+        bool masked = false;
+        char *end;
+        seg.head.pos = strtoull(content.c_str() + at + 1, &end, 10);
+        if (*end != '|')
+            break;
+        seg.head.tam = strtoul(end + 1, &end, 10);
+        if (*end != '|' || end[1] == 0)
+            break;
+        seg.head.ori = end[1];
+        end += 2;
+        if (*end == '|')
+            seg.head.win = strtoul(end + 1, &end, 10);
+        if (end[0] == '|' && end[1] == 'm')
+        {
+            masked = true;
+            end += 2;
+        }
+        if (*end != '>')
+            break;
+        at = end + 1 - content.c_str();
+        if (at + (masked ? 2ULL : 1ULL) * seg.head.tam > content.size())
+            break;
+        if (seg.head.ori == 'h')
+        { //The frequencies of the section pos:
+            if (seg.head.pos < histSections && seg.head.tam == 256 * sizeof(float))
+            {
+                hist.resize(histSections * 256, 0);
+                memcpy(hist.data() + seg.head.pos * 256, content.data() + at, seg.head.tam);
+            }
+            at += seg.head.tam;
+            continue;
+        }
+        seg.bytes = content.substr(at, seg.head.tam);
+        at += seg.head.tam;
+        if (masked)
+        {
+            seg.mask = content.substr(at, seg.head.tam);
+            at += seg.head.tam;
+        }
+        segments.push_back(seg);
+    }
+    return true;
+}
+
+//Writes a "print" file with the segments and the average frequencies of the bytes of each section, as records <section|1024|h> followed by 256 floats.
+//=false if it could not be written whole.
+bool writePrint(string printPath, const vector<printSegment> &segments, const float hist[histSections][256])
+{
+    string printBuffer;
+    char head[64];
+    for (unsigned int i = 0; i < segments.size(); i++)
+    {
+        const header &h = segments[i].head;
+        if (!segments[i].mask.empty())
+            snprintf(head, sizeof(head), "<%llu|%u|%c|%u|m>", h.pos, h.tam, h.ori, h.win);
+        else if (h.win == 0)
+            snprintf(head, sizeof(head), "<%llu|%u|%c>", h.pos, h.tam, h.ori);
+        else
+            snprintf(head, sizeof(head), "<%llu|%u|%c|%u>", h.pos, h.tam, h.ori, h.win);
+        printBuffer += head;
+        printBuffer += segments[i].bytes;
+        printBuffer += segments[i].mask;
+    }
+    for (unsigned int s = 0; s < histSections; s++)
+    {
+        snprintf(head, sizeof(head), "<%u|%u|h>", s, (unsigned)sizeof(hist[s]));
+        printBuffer += head;
+        printBuffer.append((const char *)hist[s], sizeof(hist[s]));
+    }
+    return writeBytes(printPath, printBuffer);
+}
+
+//Names of the "print" files, sorted. =false if the folder "prints" does not exist.
+bool listPrints(vector<string> &names)
+{
+    DIR *dir;
+    struct dirent *ent;
+    if ((dir = opendir("prints")) == NULL)
+        return false;
+    while ((ent = readdir(dir)) != NULL)
+    {
+        string name = ent->d_name;
+        if (name.size() > 6 && name.compare(name.size() - 6, 6, ".print") == 0)
+            names.push_back(name);
+    }
+    closedir(dir);
+    sort(names.begin(), names.end());
+    return true;
+}
+
+//Builds the image of the database from the "print" files, =false if there are no "print" files.
+bool buildPrints(string &image)
+{
+    vector<string> names;
+    vector<dbPrint> prints;
+    vector<dbSegment> segments;
+    string pool;
+    dbHeader head = {};
+    if (!listPrints(names))
+    {
+        printHelp(5, "");
+        return false;
+    }
+    if (names.empty())
+    {
+        printHelp(6, "");
+        return false;
+    }
+    for (unsigned int i = 0; i < names.size(); i++)
+    {
+        vector<printSegment> printSegments;
+        vector<float> hist;
+        readPrint("prints/" + names[i], printSegments, hist);
+        dbPrint print = {};
+        string ext = names[i].substr(0, names[i].size() - 6);
+        print.name = pool.size();
+        print.nameLen = ext.size();
+        print.first = segments.size();
+        print.hist = noHist;
+        pool += ext;
+        if (!hist.empty())
+        { //The frequencies are kept apart from the segments, aligned so they can be read as floats:
+            pool.resize((pool.size() + 7) & ~7ULL, 0);
+            print.hist = pool.size();
+            pool.append((const char *)hist.data(), hist.size() * sizeof(float));
+        }
+        for (unsigned int k = 0; k < printSegments.size(); k++)
+        {
+            //The bytes between the fields are zeros, the same prints always give the same image (and the same digest):
+            dbSegment seg;
+            memset(&seg, 0, sizeof(seg));
+            seg.head.pos = printSegments[k].head.pos;
+            seg.head.tam = printSegments[k].head.tam;
+            seg.head.ori = printSegments[k].head.ori;
+            seg.head.win = printSegments[k].head.win;
+            seg.data = pool.size();
+            pool += printSegments[k].bytes;
+            seg.mask = noMask;
+            if (!printSegments[k].mask.empty())
+            {
+                seg.mask = pool.size();
+                pool += printSegments[k].mask;
+            }
+            if (seg.head.ori == 'd')
+                head.headWindow = max(head.headWindow, seg.head.pos + seg.head.win + seg.head.tam);
+            else if (seg.head.ori == 'i')
+                head.tailWindow = max(head.tailWindow, seg.head.pos + seg.head.win);
+            segments.push_back(seg);
+        }
+        print.count = segments.size() - print.first;
+        prints.push_back(print);
+    }
+    memcpy(head.magic, dbMagic, 4);
+    head.version = dbVersion;
+    head.printCount = prints.size();
+    head.segmentCount = segments.size();
+    head.poolSize = pool.size();
+    image.assign((const char *)&head, sizeof(head));
+    image.append((const char *)prints.data(), prints.size() * sizeof(dbPrint));
+    image.append((const char *)segments.data(), segments.size() * sizeof(dbSegment));
+    image += pool;
+    return true;
+}
+
+unsigned int prefixKey(const unsigned char *bytes, unsigned int len)
+{
+    unsigned int key = 0;
+    for (unsigned int i = 0; i < len; i++)
+        key |= (unsigned int)bytes[i] << (8 * i);
+    return key;
+}
+
+//Index of the position of the main header (segment at position 0 of the straight view) of a print in db.segments, -1 if it has not.
+int mainHeader(const printDB &db, unsigned int p)
+{
+    for (unsigned int s = db.prints[p].first; s < db.prints[p].first + db.prints[p].count; s++)
+    {
+        if (db.segments[s].head.pos == 0 && db.segments[s].head.ori == 'd' && db.segments[s].head.tam > 0)
+            return s;
+    }
+    return -1;
+}
+
+void indexPrints(printDB &db)
+{
+    for (unsigned int p = 0; p < db.head->printCount; p++)
+    {
+        int s = mainHeader(db, p);
+        unsigned int len = 0;
+        db.hasHist = db.hasHist || db.prints[p].hist != noHist;
+        //Only the bytes before the first one that is not compared can be in the key:
+        while (s != -1 && len < min(db.segments[s].head.tam, prefixLen) && (db.segments[s].mask == noMask || db.pool[db.segments[s].mask + len] != 0))
+            len++;
+        if (len == 0)
+            db.noPrefix.push_back(p);
+        else
+            db.prefixes[len][prefixKey(db.pool + db.segments[s].data, len)].push_back(p);
+        db.maxWeight.push_back(answerWeight(db.prints[p].count, db.prints[p].count, s != -1, (db.prints[p].hist != noHist) ? 1 : 0));
+        db.byWeight.push_back(p);
+    }
+    stable_sort(db.byWeight.begin(), db.byWeight.end(), [&db](unsigned int a, unsigned int b)
+                { return db.maxWeight[a] > db.maxWeight[b]; });
+}
+
+//Loads the prints: maps the compiled database if it exists, if not it is built from the "print" files.
+bool loadPrints(printDB &db)
+{
+    phaseTimer timer(statLoad);
+    vector<string> names;
+    if (checkFile(dbPath) == 0)
+    {
+        int fd = open(dbPath.c_str(), O_RDONLY);
+        struct stat info;
+        if (fd != -1 && fstat(fd, &info) == 0 && info.st_size > 0)
+        {
+            db.mapSize = info.st_size;
+            db.map = mmap(NULL, db.mapSize, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (db.map == MAP_FAILED)
+                db.map = NULL;
+        }
+        if (fd != -1)
+            close(fd);
+        if (db.map == NULL || !attachPrints(db, (const char *)db.map, db.mapSize))
+        {
+            printHelp(8, dbPath);
+            return false;
+        }
+    }
+#ifdef PRINTRACK_EMBEDDED
+    else if (!listPrints(names) || names.empty())
+    { //There are no prints outside of the binary, we use the ones inside it (without reading anything):
+        if (!attachPrints(db, (const char *)embeddedPrints, sizeof(embeddedPrints)))
+        {
+            printHelp(8, embedPath);
+            return false;
+        }
+    }
+#endif
+    else if (!buildPrints(db.image) || !attachPrints(db, db.image.data(), db.image.size()))
+        return false;
+    indexPrints(db);
+    return true;
+}
+
+//Compiles all the "print" files in the database.
+void compilePrints()
+{
+    string image;
+    if (!buildPrints(image))
+        return;
+    string tmpPath = dbPath + ".tmp";
+    if (writeBytes(tmpPath, image))
+        rename(tmpPath.c_str(), dbPath.c_str());
+    else
+        printHelp(10, dbPath);
+    return;
+}
+
+//Writes the database of all the "print" files as a C++ header (printrack_prints.h) that a binary built with -DPRINTRACK_EMBEDDED keeps
+//inside it, to identify without the folder "prints".
+void embedPrints()
+{
+    string image;
+    if (!buildPrints(image))
+        return;
+    string text = "//Print database of printrack, generated by printrack --embed. Build with -DPRINTRACK_EMBEDDED to use it.\n";
+    text += "alignas(8) constexpr unsigned char embeddedPrints[" + to_string(image.size()) + "] = {";
+    char byte[16];
+    for (size_t i = 0; i < image.size(); i++)
+    {
+        snprintf(byte, sizeof(byte), "%s0x%02x,", (i % 16 == 0) ? "\n    " : " ", (unsigned char)image[i]);
+        text += byte;
+    }
+    text += "\n};\n";
+    string tmpPath = embedPath + ".tmp";
+    if (!writeBytes(tmpPath, text) || rename(tmpPath.c_str(), embedPath.c_str()) != 0)
+    {
+        remove(tmpPath.c_str());
+        printHelp(10, embedPath);
+        return;
+    }
+    printf("\nThe prints (%u extensions, %llu bytes) were written in \"%s\", build with -DPRINTRACK_EMBEDDED to keep them inside printrack.\n\n",
+           ((const dbHeader *)image.data())->printCount, (unsigned long long int)image.size(), embedPath.c_str());
+    return;
+}
+
+//If all the bytes of a run that has different bytes are found near its position in the input file, the run survives as a floating run,
+//with a window that covers the distance it moved, and its different bytes are not removed.
+void keepFloating(FILE *input, unsigned long long int inputSize, FILE *learnFile, const learnState &state, vector<learnSpan> &runs, long long int shift, vector<learnSpan> &dead)
+{
+    vector<learnSpan> stillDead;
+    vector<unsigned char> bytes, window;
+    unsigned int d = 0;
+    for (unsigned int r = 0; r < runs.size(); r++)
+    {
+        learnSpan &run = runs[r];
+        unsigned int first = d;
+        bool moved = false;
+        while (d < dead.size() && dead[d].start < run.start + run.len)
+            d++;
+        if (d > first && run.len >= floatMin && run.len <= floatMax)
+        {
+            long long int expected = run.start + shift;
+            long long int from = max(expected - (long long int)floatWindow, 0LL);
+            long long int to = min(expected + (long long int)(run.len + floatWindow), (long long int)inputSize);
+            if (to - from >= (long long int)run.len)
+            {
+                bytes.resize(run.len);
+                window.resize(to - from);
+                readReference(learnFile, state, run.start, run.len, (char *)bytes.data());
+                countedSeek(input, from);
+                window.resize(countedRead(window.data(), window.size(), input));
+                //We keep the appearance nearest to the position of the run:
+                unsigned long long int distance = floatWindow + 1;
+                for (size_t at = findSegment(window.data(), window.size(), bytes.data(), run.len); at < window.size();
+                     at += 1 + findSegment(window.data() + at + 1, window.size() - at - 1, bytes.data(), run.len))
+                    distance = min(distance, (unsigned long long int)llabs(from + (long long int)at - expected));
+                if (distance <= floatWindow)
+                {
+                    run.win = max(run.win, (unsigned int)distance);
+                    moved = true;
+                }
+            }
+        }
+        if (!moved)
+            stillDead.insert(stillDead.end(), dead.begin() + first, dead.begin() + d);
+    }
+    dead = stillDead;
+}
+
+//Searches new floating runs near the beginning (straight view) or the end (inverted view) of the reference: strings of at least
+//floatDiscover bytes with removed bytes in their position that are repeated in the input file a few bytes before or after it.
+vector<learnSpan> discoverFloating(FILE *input, unsigned long long int inputSize, FILE *learnFile, const learnState &state, int v, long long int shift, const vector<learnSpan> &dead)
+{
+    vector<learnSpan> found;
+    vector<unsigned char> ref, sample;
+    unsigned long long int scanLo = (v == 0) ? 0 : state.refSize - min(state.refSize, (unsigned long long int)floatScan);
+    unsigned long long int scanHi = (v == 0) ? min(state.refSize, (unsigned long long int)floatScan) : state.refSize;
+    unsigned int d = 0;
+    for (unsigned int r = 0; r < state.runs[v].size(); r++)
+    {
+        unsigned long long int from = max(state.runs[v][r].start, scanLo);
+        unsigned long long int to = min(state.runs[v][r].start + state.runs[v][r].len, scanHi);
+        if (from + floatDiscover > to)
+            continue;
+        while (d < dead.size() && dead[d].start + dead[d].len <= from)
+            d++;
+        if (d >= dead.size() || dead[d].start >= to)
+            continue;
+        long long int sampleFrom = max((long long int)from + shift - (long long int)floatWindow, 0LL);
+        long long int sampleTo = min((long long int)to + shift + (long long int)floatWindow, (long long int)inputSize);
+        if (sampleFrom >= sampleTo)
+            continue;
+        ref.resize(to - from);
+        sample.resize(sampleTo - sampleFrom);
+        readReference(learnFile, state, from, to - from, (char *)ref.data());
+        countedSeek(input, sampleFrom);
+        sample.resize(countedRead(sample.data(), sample.size(), input));
+        //We try the shifts from the nearest to the farthest, the first string found keeps its bytes:
+        for (long long int step = 1; step <= 2 * (long long int)floatWindow; step++)
+        {
+            long long int delta = (step % 2 == 1) ? (step + 1) / 2 : -step / 2;
+            long long int base = (long long int)from + shift + delta - sampleFrom; //Position in sample of the byte ref[0].
+            long long int j = max(-base, 0LL);
+            long long int end = min((long long int)ref.size(), (long long int)sample.size() - base);
+            while (j < end)
+            {
+                unsigned long long int equal = matchLength(ref.data() + j, sample.data() + base + j, end - j);
+                learnSpan stretch = {from + j, equal, (unsigned int)llabs(delta)};
+                j += equal + 1;
+                if (equal < floatDiscover)
+                    continue;
+                auto firstDead = upper_bound(dead.begin(), dead.end(), stretch.start, [](unsigned long long int pos, const learnSpan &span)
+                                             { return pos < span.start + span.len; });
+                if (firstDead == dead.end() || firstDead->start >= stretch.start + stretch.len)
+                    continue;
+                bool overlaps = false;
+                for (unsigned int i = 0; i < found.size() && !overlaps; i++)
+                    overlaps = found[i].start < stretch.start + stretch.len && stretch.start < found[i].start + found[i].len;
+                if (!overlaps)
+                    found.push_back(stretch);
+            }
+        }
+    }
+    sort(found.begin(), found.end(), [](const learnSpan &a, const learnSpan &b)
+         { return a.start < b.start; });
+    return found;
+}
+
+//PRINT COMPACTION:
+/* Before a print is written the segments that tell little about the extension are dropped, and the rest are sorted so the ones that
+* distinguish it best from the other extensions in "prints" are compared first:
+* -> The runs of the learn file that are near each other were joined in one segment (the bytes between them are not compared).
+* -> The segments that compare less than shortSegment bytes are dropped, they are found by chance in any file.
+* -> The segments that the prints of more than sharedMax other extensions also have (the same bytes in the same positions) are dropped.
+* The main header is always kept, and the rest are sorted by the bytes they compare divided by the extensions that share them.
+*/
+const unsigned int mergeGap = 8;     //Runs separated by at most this many bytes are joined in one segment.
+const unsigned int shortSegment = 2; //Shortest segment (in bytes compared) that is kept.
+const unsigned int sharedMax = 2;    //Most other extensions that can share a segment that is kept.
+
+unsigned int comparedBytes(const printSegment &seg)
+{
+    return seg.mask.empty() ? seg.head.tam : count(seg.mask.begin(), seg.mask.end(), (char)0xFF);
+}
+
+//Position of the first byte of the segment: from the beginning of the file (>= 0) or from the end (< 0).
+long long int segmentAnchor(const header &head)
+{
+    return (head.ori == 'd') ? (long long int)head.pos : -(long long int)head.pos;
+}
+
+bool segmentBefore(const printSegment &a, const printSegment &b)
+{
+    return make_pair(a.head.ori, segmentAnchor(a.head)) < make_pair(b.head.ori, segmentAnchor(b.head));
+}
+
+//=true if every byte that the segment compares is compared too by a fixed segment of the other print (sorted with segmentBefore),
+//in the same position and with the same value.
+bool sharedWith(const printSegment &seg, const vector<printSegment> &other)
+{
+    long long int anchor = segmentAnchor(seg.head);
+    for (unsigned int k = 0; k < seg.head.tam; k++)
+    {
+        if (!seg.mask.empty() && seg.mask[k] == 0)
+            continue;
+        printSegment key;
+        key.head = {0, 0, seg.head.ori, 0};
+        key.head.pos = (seg.head.ori == 'd') ? anchor + k : -(anchor + k);
+        auto it = upper_bound(other.begin(), other.end(), key, segmentBefore);
+        if (it == other.begin())
+            return false;
+        it--;
+        long long int at = anchor + k - segmentAnchor(it->head);
+        if (it->head.ori != seg.head.ori || it->head.win != 0 || at >= it->head.tam)
+            return false;
+        if ((!it->mask.empty() && it->mask[at] == 0) || it->bytes[at] != seg.bytes[k])
+            return false;
+    }
+    return true;
+}
+
+void compactPrint(vector<printSegment> &segments, const vector<const vector<printSegment> *> &others)
+{
+    vector<pair<double, printSegment>> kept;
+    for (unsigned int i = 0; i < segments.size(); i++)
+    {
+        const printSegment &seg = segments[i];
+        unsigned int shared = 0;
+        for (unsigned int o = 0; o < others.size(); o++)
+            shared += sharedWith(seg, *others[o]) ? 1 : 0;
+        bool mainHead = seg.head.pos == 0 && seg.head.ori == 'd';
+        if (!mainHead && (comparedBytes(seg) < shortSegment || shared > sharedMax))
+            continue;
+        kept.push_back({mainHead ? HUGE_VAL : (double)comparedBytes(seg) / (1 + shared), seg});
+    }
+    stable_sort(kept.begin(), kept.end(), [](const pair<double, printSegment> &a, const pair<double, printSegment> &b)
+                { return a.first > b.first; });
+    segments.clear();
+    for (unsigned int i = 0; i < kept.size(); i++)
+        segments.push_back(kept[i].second);
+}
+
+//RESULT CACHE:
+/* The answers of the bulk identify are kept in prints/results.cache, for each file by its device and its inode, with its size and the
+* time of its last modification. A file that did not change is not read again while the prints (the digest of the database) and the
+* options that change the answers (--budget and --top) are the same, with any change of them the cache starts again empty. The files
+* that were not scanned are kept too (another scan may come back to them), until there are more than cacheLimit: then they are dropped.
+* --no-cache neither reads it nor writes it.
+* Format (numbers in the byte order of the machine):
+* "PTRC" | version (u32) | digest (u64) | number of files (u64) | files: device (u64), inode (u64), size (u64), mtime (seconds u64,
+* nanoseconds u64), number of answers (u32), answers: length of the extension (u32), extension, weight (i32), success rate (float),
+* total prints (i32), header matched (u8).
+*/
+const string cachePath = "prints/results.cache";
+const unsigned int cacheVersion = 1;
+const unsigned long long int cacheLimit = 1 << 18; //Files kept in the cache, the ones of the last scan are always kept.
+bool useCache = true; //--no-cache = false.
+
+struct cacheEntry
+{
+    unsigned long long int size, seconds, nanos;
+    vector<ans> answers;
+    bool seen; // =true if the file was found in this scan.
+};
+
+struct resultCache
+{
+    unsigned long long int digest;
+    map<pair<unsigned long long int, unsigned long long int>, cacheEntry> files; // By device and inode.
+    mutex lock;
+    bool changed = false;
+};
+
+//Digest of the prints (the whole image of the database) and of the options that change the answers.
+unsigned long long int cacheDigest(const printDB &db)
+{
+    unsigned long long int digest = bytesDigest((const unsigned char *)db.head, (db.pool - (const unsigned char *)db.head) + db.head->poolSize);
+    digest = bytesDigest((const unsigned char *)&histBudget, sizeof(histBudget), digest);
+    return bytesDigest((const unsigned char *)&topAnswers, sizeof(topAnswers), digest);
+}
+
+//The cache is empty if it does not exist, it is damaged or it was made with other prints.
+void readCache(resultCache &cache, const printDB &db)
+{
+    cache.digest = cacheDigest(db);
+    FILE *source = fopen(cachePath.c_str(), "rb");
+    if (source == NULL)
+        return;
+    char magic[4];
+    unsigned int version;
+    unsigned long long int digest, count;
+    bool valid = fread(magic, 1, 4, source) == 4 && memcmp(magic, "PTRC", 4) == 0 && getValue(source, version) && version == cacheVersion &&
+                 getValue(source, digest) && digest == cache.digest && getValue(source, count);
+    for (unsigned long long int i = 0; valid && i < count; i++)
+    {
+        unsigned long long int device, inode;
+        unsigned int answers;
+        cacheEntry entry;
+        entry.seen = false;
+        valid = getValue(source, device) && getValue(source, inode) && getValue(source, entry.size) && getValue(source, entry.seconds) &&
+                getValue(source, entry.nanos) && getValue(source, answers);
+        for (unsigned int a = 0; valid && a < answers; a++)
+        {
+            ans answer;
+            unsigned int len;
+            unsigned char gotHeader;
+            valid = getValue(source, len) && len < 256;
+            answer.ext.resize(valid ? len : 0);
+            valid = valid && fread(&answer.ext[0], 1, len, source) == len && getValue(source, answer.weight) && getValue(source, answer.pcent) &&
+                    getValue(source, answer.tp) && getValue(source, gotHeader);
+            answer.gotHeader = gotHeader != 0;
+            entry.answers.push_back(answer);
+        }
+        if (valid)
+            cache.files[{device, inode}] = entry;
+    }
+    if (!valid)
+        cache.files.clear();
+    fclose(source);
+}
+
+//=true if the file did not change since its answers were kept.
+bool findCached(resultCache &cache, const struct stat &info, vector<ans> &answers)
+{
+    lock_guard<mutex> guard(cache.lock);
+    auto it = cache.files.find({(unsigned long long int)info.st_dev, (unsigned long long int)info.st_ino});
+    if (it == cache.files.end() || it->second.size != (unsigned long long int)info.st_size ||
+        it->second.seconds != (unsigned long long int)info.st_mtim.tv_sec || it->second.nanos != (unsigned long long int)info.st_mtim.tv_nsec)
+        return false;
+    answers = it->second.answers;
+    it->second.seen = true;
+    return true;
+}
+
+void storeCached(resultCache &cache, const struct stat &info, const vector<ans> &answers)
+{
+    lock_guard<mutex> guard(cache.lock);
+    cache.files[{(unsigned long long int)info.st_dev, (unsigned long long int)info.st_ino}] =
+        {(unsigned long long int)info.st_size, (unsigned long long int)info.st_mtim.tv_sec, (unsigned long long int)info.st_mtim.tv_nsec, answers, true};
+    cache.changed = true;
+}
+
+//The cache is written in a temporary file that replaces the old one, so it is never left half written. It is not written if nothing
+//changed. Over cacheLimit files, the ones that were not found in this scan are dropped.
+void writeCache(const resultCache &cache)
+{
+    if (!cache.changed)
+        return;
+    unsigned long long int seen = 0;
+    for (auto it = cache.files.begin(); it != cache.files.end(); it++)
+        seen += it->second.seen ? 1 : 0;
+    unsigned long long int unseen = min(cache.files.size() - seen, cacheLimit - min(seen, cacheLimit));
+    string buffer = "PTRC";
+    putValue(buffer, cacheVersion);
+    putValue(buffer, cache.digest);
+    putValue(buffer, seen + unseen);
+    for (auto it = cache.files.begin(); it != cache.files.end(); it++)
+    {
+        if (!it->second.seen && unseen == 0)
+            continue;
+        if (!it->second.seen)
+            unseen--;
+        putValue(buffer, it->first.first);
+        putValue(buffer, it->first.second);
+        putValue(buffer, it->second.size);
+        putValue(buffer, it->second.seconds);
+        putValue(buffer, it->second.nanos);
+        putValue(buffer, (unsigned int)it->second.answers.size());
+        for (unsigned int a = 0; a < it->second.answers.size(); a++)
+        {
+            const ans &answer = it->second.answers[a];
+            putValue(buffer, (unsigned int)answer.ext.size());
+            buffer += answer.ext;
+            putValue(buffer, answer.weight);
+            putValue(buffer, answer.pcent);
+            putValue(buffer, answer.tp);
+            putValue(buffer, (unsigned char)(answer.gotHeader ? 1 : 0));
+        }
+    }
+    string tmpPath = cachePath + ".tmp";
+    if (writeBytes(tmpPath, buffer))
+        rename(tmpPath.c_str(), cachePath.c_str());
+}
+
+//CORE FUNCTIONS:
+//The segments of the print of an extension, made from the runs of its "learn" file (before they are compacted), and the average
+//frequencies of its bytes. =false if the extension was not learnt or its "learn" file is damaged.
+bool learntSegments(string ext, vector<printSegment> &segments, float hist[histSections][256])
+{
+    string learnPath = "learns/" + ext + ".learn";
+    if (checkFile(learnPath) != 0)
+    {
+        printHelp(4, ext);
+        return false;
+    }
+    FILE *learnFile = fopen(learnPath.c_str(), "rb");
+    if (learnFile == NULL)
+    {
+        printHelp(2, learnPath);
+        return false;
+    }
+    learnState state;
+    if (!readLearnState(learnFile, state) || !loadReference(learnFile, state, learnMemory))
+    {
+        fclose(learnFile);
+        printHelp(7, ext);
+        return false;
+    }
+    //Every run of the straight view is a string positioned from the beginning of the file, and every run of the inverted view
+    //a string positioned from the end of the file (the position is the distance from the end of the file to its first byte).
+    //The runs that are at most mergeGap bytes away from each other are joined in one segment with a mask:
+    bool whole = true;
+    for (int v = 0; v < 2 && whole; v++)
+    {
+        const vector<learnSpan> &runs = state.runs[v];
+        for (unsigned int i = 0, j; i < runs.size(); i = j)
+        {
+            for (j = i + 1; j < runs.size() && runs[j - 1].win == 0 && runs[j].win == 0 && runs[j].start - (runs[j - 1].start + runs[j - 1].len) <= mergeGap; j++)
+                ;
+            printSegment seg;
+            seg.head.pos = (v == 0) ? runs[i].start : state.refSize - runs[i].start;
+            seg.head.tam = runs[j - 1].start + runs[j - 1].len - runs[i].start;
+            seg.head.ori = (v == 0) ? 'd' : 'i';
+            seg.head.win = runs[i].win;
+            seg.bytes.assign(seg.head.tam, 0);
+            if (j - i > 1)
+                seg.mask.assign(seg.head.tam, 0);
+            for (unsigned int k = i; k < j && whole; k++)
+            {
+                whole = readReference(learnFile, state, runs[k].start, runs[k].len, &seg.bytes[runs[k].start - runs[i].start]);
+                if (!seg.mask.empty())
+                    seg.mask.replace(runs[k].start - runs[i].start, runs[k].len, runs[k].len, (char)0xFF);
+            }
+            segments.push_back(seg);
+        }
+    }
+    fclose(learnFile);
+    if (!whole)
+    { //The file is shorter than its extents:
+        segments.clear();
+        printHelp(7, ext);
+        return false;
+    }
+    //The average frequencies of the bytes of each section:
+    for (unsigned int s = 0; s < histSections; s++)
+        for (unsigned int b = 0; b < 256; b++)
+            hist[s][b] = state.hist[s][b] / state.samples;
+    return true;
+}
+
+//Makes again the prints of a list of extensions, at the same time in the thread pool: every print is made whole from the "learn"
+//file of its extension. Each print is compacted with the new segments of the other extensions of the list (and with the "print"
+//files of the rest), so the result does not depend on their order. All of them are written aside first and then they replace the old
+//ones (none of them does if one could not be written), and the database is compiled once for the whole list.
+void generatePrints(const vector<string> &extList)
+{
+    struct extensionPrint
+    {
+        string ext;
+        bool valid = false;   // =true if the "learn" file was read.
+        bool written = false; // =true if the new print was written whole aside.
+        vector<printSegment> segments, sorted;
+        float hist[histSections][256];
+    };
+    deque<extensionPrint> exts(extList.size());
+    workPool pool;
+    for (unsigned int e = 0; e < extList.size(); e++)
+        exts[e].ext = extList[e];
+    //We check if the "prints" directory exists, if not we create it:
+    if (checkFile("prints") == -1)
+    {
+        mkdir("prints", 0755);
+    }
+
+    for (unsigned int e = 0; e < exts.size(); e++)
+        pool.submit([&exts, e]
+                    {
+                        phaseTimer timer(statPrint);
+                        extensionPrint &p = exts[e];
+                        p.valid = learntSegments(p.ext, p.segments, p.hist);
+                        p.sorted = p.segments;
+                        sort(p.sorted.begin(), p.sorted.end(), segmentBefore);
+                    });
+    pool.run();
+    //The prints of the extensions that are not in the list stay as they are:
+    set<string> learnt;
+    for (unsigned int e = 0; e < exts.size(); e++)
+        learnt.insert(exts[e].ext + ".print");
+    vector<string> names;
+    vector<vector<printSegment>> kept;
+    listPrints(names);
+    for (unsigned int i = 0; i < names.size(); i++)
+    {
+        vector<printSegment> other;
+        vector<float> hist;
+        if (learnt.count(names[i]) || !readPrint("prints/" + names[i], other, hist))
+            continue;
+        sort(other.begin(), other.end(), segmentBefore);
+        kept.push_back(other);
+    }
+
+    for (unsigned int e = 0; e < exts.size(); e++)
+        pool.submit([&exts, &kept, e]
+                    {
+                        phaseTimer timer(statPrint);
+                        extensionPrint &p = exts[e];
+                        if (!p.valid)
+                            return;
+                        vector<const vector<printSegment> *> others;
+                        for (unsigned int o = 0; o < exts.size(); o++)
+                        {
+                            if (o != e && exts[o].valid)
+                                others.push_back(&exts[o].sorted);
+                        }
+                        for (unsigned int o = 0; o < kept.size(); o++)
+                            others.push_back(&kept[o]);
+                        compactPrint(p.segments, others);
+                        p.written = writePrint("prints/" + p.ext + ".print.tmp", p.segments, p.hist);
+                    });
+    pool.run();
+    //If a print could not be written none replaces the old one, the set of prints is never half new:
+    bool complete = true;
+    for (unsigned int e = 0; e < exts.size(); e++)
+    {
+        if (exts[e].valid && !exts[e].written)
+        {
+            printHelp(10, "prints/" + exts[e].ext + ".print");
+            complete = false;
+        }
+    }
+    for (unsigned int e = 0; e < exts.size(); e++)
+    {
+        string printPath = "prints/" + exts[e].ext + ".print";
+        if (exts[e].written && complete)
+            rename((printPath + ".tmp").c_str(), printPath.c_str());
+        else if (exts[e].written)
+            remove((printPath + ".tmp").c_str());
+    }
+    if (!complete)
+        return;
+    if (checkFile(dbPath) == 0)
+        compilePrints();
+    return;
+}
+
+void generatePrint(string ext)
+{
+    generatePrints(vector<string>(1, ext));
+}
+
+//With -p --all the prints of every extension of "learns" are made again.
+void generateAllPrints()
+{
+    vector<string> extList;
+    DIR *dir = opendir("learns");
+    struct dirent *ent;
+    if (dir == NULL)
+    {
+        printHelp(11, "");
+        return;
+    }
+    while ((ent = readdir(dir)) != NULL)
+    {
+        string name = ent->d_name;
+        if (name.size() > 6 && name.compare(name.size() - 6, 6, ".learn") == 0)
+            extList.push_back(name.substr(0, name.size() - 6));
+    }
+    closedir(dir);
+    sort(extList.begin(), extList.end());
+    generatePrints(extList);
+}
+
+//The print of an extension is made again every time it learns, once it has learnt two samples (with only one every byte of the sample
+//would be a segment of the print). It is a whole regeneration, so a learn command (with one file or many) makes the prints of all
+//its extensions together, the other prints are read and the database is compiled once per command and not once per sample.
+void printLearnt(const vector<string> &extList)
+{
+    vector<string> ready;
+    for (unsigned int e = 0; e < extList.size(); e++)
+    {
+        learnState state;
+        FILE *learnFile = fopen(("learns/" + extList[e] + ".learn").c_str(), "rb");
+        if (learnFile == NULL)
+            continue;
+        if (readLearnState(learnFile, state) && state.samples >= 2)
+            ready.push_back(extList[e]);
+        fclose(learnFile);
+    }
+    if (!ready.empty())
+        generatePrints(ready);
+}
+
+//Compares a sample (input, of inputSize bytes) with the state of its extension and gives the state after learning it, freq are the
+//frequencies of the bytes of the sample. The state does not change, the bytes of its reference are read from learnFile (or from memory).
+learnState learnSample(FILE *input, unsigned long long int inputSize, FILE *learnFile, const learnState &state, const float freq[histSections][256])
+{
+    learnState newState;
+    unsigned long long int offset = 0;
+    size_t readed;
+    vector<char> block(learnBlock);                    //Block of the input file.
+    vector<char> ref(learnBlock);                      //Bytes of the reference that we are comparing with the block.
+    vector<learnSpan> dead[2];                         //Bytes of each view that are different in the input file.
+    vector<learnSpan> runs[2] = {state.runs[0], state.runs[1]}; //The runs, with the windows of the runs that float in this sample.
+    unsigned int cursor[2] = {0, 0};
+    //Position in the input file of each byte of the reference: straight = same position, inverted = aligned at the end.
+    long long int shift[2] = {0, (long long int)inputSize - (long long int)state.refSize};
+
+    //Only the parts of the input file where the runs of some view fall are read (once, block by block), and each block is compared
+    //with both views. The parts that are near each other are read together to save seeks:
+    vector<learnSpan> parts[2];
+    for (int v = 0; v < 2; v++)
+    {
+        for (unsigned int r = 0; r < runs[v].size(); r++)
+        {
+            long long int from = max((long long int)runs[v][r].start + shift[v], 0LL);
+            long long int to = min((long long int)(runs[v][r].start + runs[v][r].len) + shift[v], (long long int)inputSize);
+            if (from < to)
+                parts[v].push_back({(unsigned long long int)from, (unsigned long long int)(to - from), 0});
+        }
+    }
+    vector<learnSpan> reads;
+    vector<learnSpan> joined = joinSpans(parts[0], parts[1]);
+    for (unsigned int i = 0; i < joined.size(); i++)
+    {
+        if (!reads.empty() && joined[i].start - (reads.back().start + reads.back().len) < learnGap)
+            reads.back().len = joined[i].start + joined[i].len - reads.back().start;
+        else
+            reads.push_back(joined[i]);
+    }
+    for (unsigned int part = 0; part < reads.size(); part++)
+    {
+        offset = reads[part].start;
+        countedSeek(input, offset);
+        while (offset < reads[part].start + reads[part].len && (readed = countedRead(block.data(), min((unsigned long long int)learnBlock, reads[part].start + reads[part].len - offset), input)) > 0)
+        {
+            for (int v = 0; v < 2; v++)
+            {
+                //Range of the reference that is compared with this block:
+                long long int lo = max((long long int)offset - shift[v], 0LL);
+                long long int hi = min((long long int)(offset + readed) - shift[v], (long long int)state.refSize);
+                while (cursor[v] < runs[v].size() && (long long int)(runs[v][cursor[v]].start + runs[v][cursor[v]].len) <= lo)
+                    cursor[v]++;
+                for (unsigned int r = cursor[v]; r < runs[v].size() && (long long int)runs[v][r].start < hi; r++)
+                {
+                    unsigned long long int from = max((long long int)runs[v][r].start, lo);
+                    unsigned long long int to = min((long long int)(runs[v][r].start + runs[v][r].len), hi);
+                    const unsigned char *sample = (const unsigned char *)block.data() + (from + shift[v] - offset);
+                    readReference(learnFile, state, from, to - from, ref.data());
+                    //We jump from one different byte to the next:
+                    for (unsigned long long int i = matchLength((const unsigned char *)ref.data(), sample, to - from); i < to - from;
+                         i += 1 + matchLength((const unsigned char *)ref.data() + i + 1, sample + i + 1, to - from - i - 1))
+                    {
+                        if (!dead[v].empty() && dead[v].back().start + dead[v].back().len == from + i)
+                            dead[v].back().len++;
+                        else
+                            dead[v].push_back({from + i, 1, 0});
+                    }
+                }
+            }
+            offset += readed;
+        }
+    }
+    //A run that is not in its position may have moved a few bytes (as the EOF of the pdf files), and some of the removed bytes
+    //may be strings that moved:
+    vector<learnSpan> floating[2];
+    for (int v = 0; v < 2; v++)
+    {
+        keepFloating(input, inputSize, learnFile, state, runs[v], shift[v], dead[v]);
+        floating[v] = discoverFloating(input, inputSize, learnFile, state, v, shift[v], dead[v]);
+    }
+    //The bytes of the reference that fall outside of the input file are not repeated in it, so they are removed too:
+    newState.samples = state.samples + 1;
+    newState.refSize = state.refSize;
+    for (unsigned int s = 0; s < histSections; s++)
+        for (unsigned int b = 0; b < 256; b++)
+            newState.hist[s][b] = state.hist[s][b] + freq[s][b];
+    for (int v = 0; v < 2; v++)
+    {
+        long long int lo = max(-shift[v], 0LL);
+        long long int hi = max(min((long long int)inputSize - shift[v], (long long int)state.refSize), lo);
+        newState.runs[v] = cutSpans(runs[v], lo, hi, dead[v]);
+        if (!floating[v].empty())
+        { //The new floating runs replace the bytes that survived in their position:
+            vector<learnSpan> exact = cutSpans(newState.runs[v], 0, state.refSize, floating[v]);
+            newState.runs[v].clear();
+            merge(exact.begin(), exact.end(), floating[v].begin(), floating[v].end(), back_inserter(newState.runs[v]), [](const learnSpan &a, const learnSpan &b)
+                  { return a.start < b.start; });
+        }
+    }
+    newState.extents = joinSpans(newState.runs[0], newState.runs[1]);
+    return newState;
+}
+
+//State that learnt the samples of a and b, both learnt from base: every run survives only where it survived in both.
+learnState mergeLearnt(const learnState &a, const learnState &b, const learnState &base)
+{
+    learnState retMe;
+    retMe.samples = a.samples + b.samples - base.samples;
+    retMe.refSize = base.refSize;
+    for (unsigned int s = 0; s < histSections; s++)
+        for (unsigned int v = 0; v < 256; v++)
+            retMe.hist[s][v] = a.hist[s][v] + b.hist[s][v] - base.hist[s][v];
+    for (int v = 0; v < 2; v++)
+        retMe.runs[v] = meetSpans(a.runs[v], b.runs[v]);
+    retMe.extents = joinSpans(retMe.runs[0], retMe.runs[1]);
+    return retMe;
+}
+
+void learn(string filename, bool printIt = true)
+{
+    phaseTimer timer(statLearn);
+    FILE *input = fopen(filename.c_str(), "rb");
+    if (input == NULL)
+    {
+        printHelp(2, filename);
+        return;
+    }
+    unsigned long long int endIndex = filesize(input);
+    learnState state;
+
+    //We check if the directory "learns" exists, if not we create it:
+    if (checkFile("learns") == -1)
+    {
+        mkdir("learns", 0755);
+    }
+    //Route for the "learn" file:
+    string ext = extension(filename);
+    string filepath = "learns/" + ext + ".learn";
+    float freq[histSections][256];
+    fileHistograms(input, endIndex, histBudget, freq);
+    //We check if we have to make the "learn" file or if it was created previously:
+    if (checkFile(filepath) == -1)
+    { //The extension is new, the whole file survives in both views:
+        state.samples = 1;
+        state.refSize = endIndex;
+        for (unsigned int s = 0; s < histSections; s++)
+            copy(freq[s], freq[s] + 256, state.hist[s]);
+        if (endIndex > 0)
+        { //Only the window of the file is learnt:
+            unsigned long long int head = min(learnHead, endIndex);
+            unsigned long long int tail = endIndex - min(learnTail, endIndex);
+            state.runs[0].push_back({0, head, 0});
+            if (head < tail && learnInterior > 0)
+            { //The blocks of the interior at the same distance from each other, or the whole interior if they do not fit:
+                if (tail - head <= (unsigned long long int)learnInterior * interiorBlock)
+                    state.runs[0].push_back({head, tail - head, 0});
+                for (unsigned int k = 0; k < learnInterior && tail - head > (unsigned long long int)learnInterior * interiorBlock; k++)
+                    state.runs[0].push_back({head + (tail - head - interiorBlock) * (k + 1) / (learnInterior + 1), interiorBlock, 0});
+            }
+            state.runs[1].push_back({tail, endIndex - tail, 0});
+            state.extents = joinSpans(state.runs[0], state.runs[1]);
+            //The bytes of the extents are copied from the same positions of the file:
+            for (unsigned int i = 0; i < state.extents.size(); i++)
+                state.extentData.push_back(state.extents[i].start);
+        }
+        if (!writeLearnState(filepath, state, input, state))
+        {
+            fclose(input);
+            return;
+        }
+    }
+    else
+    { //We know the extension and the runs must be cut where the bytes are different:
+        FILE *learnFile = fopen(filepath.c_str(), "rb");
+        if (learnFile == NULL)
+        {
+            fclose(input);
+            printHelp(2, filepath);
+            return;
+        }
+        if (!readLearnState(learnFile, state) || !loadReference(learnFile, state, learnMemory))
+        {
+            fclose(learnFile);
+            fclose(input);
+            printHelp(7, ext);
+            return;
+        }
+        bool written = writeLearnState(filepath, learnSample(input, endIndex, learnFile, state, freq), learnFile, state);
+        fclose(learnFile);
+        if (!written)
+        {
+            fclose(input);
+            return;
+        }
+    }
+    fclose(input);
+    if (printIt)
+        printLearnt(vector<string>(1, ext));
+    return;
+}
+
+//Learns many files and directories (read recursively) on all the cores of the machine. The files are grouped by extension, the files
+//of an extension are compared at the same time with the reference of its "learn" file (loaded in memory), and the states that they
+//give are merged by pairs, like a tree, until one remains. Each "learn" file is written once.
+void learnBatch(const vector<string> &paths)
+{
+    struct learnGroup
+    {
+        string ext;
+        learnState base;
+        vector<string> files;
+        vector<learnState> learnt; // State after learning each file.
+        vector<char> readed;       // =false if the file could not be read, it does not change the state (char and not bool, the tasks write them at the same time).
+    };
+    map<string, vector<string>> byExtension;
+    function<void(string, string)> addPath = [&](string path, string name)
+    {
+        struct stat info;
+        if (stat(path.c_str(), &info) != 0)
+            printHelp(2, path);
+        else if (S_ISDIR(info.st_mode))
+        {
+            DIR *dir = opendir(path.c_str());
+            struct dirent *ent;
+            while (dir != NULL && (ent = readdir(dir)) != NULL)
+            {
+                string entry = ent->d_name;
+                if (entry != "." && entry != "..")
+                    addPath(path + "/" + entry, entry);
+            }
+            if (dir != NULL)
+                closedir(dir);
+        }
+        else if (S_ISREG(info.st_mode))
+        { //The extension is taken from the name only, the directories can have dots (sockets, pipes and devices are not learnt):
+            string ext = extension(name);
+            if (!ext.empty())
+                byExtension[ext].push_back(path);
+        }
+    };
+    for (unsigned int i = 0; i < paths.size(); i++)
+    {
+        string path = paths[i];
+        while (path.size() > 1 && path.back() == '/')
+            path.pop_back();
+        addPath(path, path.substr(path.find_last_of('/') + 1));
+    }
+    if (checkFile("learns") == -1)
+    {
+        mkdir("learns", 0755);
+    }
+
+    //The first file of a new extension is its reference, and while the reference learnt only one sample all its bytes are alive: the
+    //first two files are learnt before the others, so the others are compared only with the bytes that survived them.
+    deque<learnGroup> groups;
+    for (auto it = byExtension.begin(); it != byExtension.end(); it++)
+    {
+        string learnPath = "learns/" + it->first + ".learn";
+        vector<string> &files = it->second;
+        learnGroup group;
+        bool valid = false;
+        sort(files.begin(), files.end());
+        while (!files.empty())
+        {
+            FILE *learnFile = fopen(learnPath.c_str(), "rb");
+            group.base = learnState();
+            valid = learnFile != NULL && readLearnState(learnFile, group.base);
+            if (learnFile == NULL || (valid && group.base.samples < 2))
+            {
+                if (learnFile != NULL)
+                    fclose(learnFile);
+                learn(files[0], false);
+                files.erase(files.begin());
+                continue;
+            }
+            valid = valid && loadReference(learnFile, group.base);
+            fclose(learnFile);
+            break;
+        }
+        if (files.empty())
+            continue;
+        if (!valid)
+        {
+            printHelp(7, it->first);
+            continue;
+        }
+        group.ext = it->first;
+        group.files = files;
+        group.learnt.resize(files.size());
+        group.readed.assign(files.size(), false);
+        groups.push_back(move(group));
+    }
+
+    workPool pool;
+    for (unsigned int g = 0; g < groups.size(); g++)
+    {
+        for (unsigned int i = 0; i < groups[g].files.size(); i++)
+        {
+            pool.submit([&groups, g, i]
+                        {
+                            phaseTimer timer(statLearn);
+                            learnGroup &group = groups[g];
+                            FILE *input = fopen(group.files[i].c_str(), "rb");
+                            if (input == NULL)
+                            {
+                                printHelp(2, group.files[i]);
+                                return;
+                            }
+                            unsigned long long int size = filesize(input);
+                            float freq[histSections][256];
+                            fileHistograms(input, size, histBudget, freq);
+                            group.learnt[i] = learnSample(input, size, NULL, group.base, freq);
+                            group.readed[i] = true;
+                            fclose(input); });
+        }
+    }
+    pool.run();
+    //Every round merges the states that are step positions away from each other:
+    for (unsigned int step = 1;; step *= 2)
+    {
+        bool merging = false;
+        for (unsigned int g = 0; g < groups.size(); g++)
+        {
+            for (unsigned int i = 0; i + step < groups[g].files.size(); i += 2 * step)
+            {
+                merging = true;
+                pool.submit([&groups, g, i, step]
+                            {
+                                learnGroup &group = groups[g];
+                                if (!group.readed[i + step])
+                                    return;
+                                if (!group.readed[i])
+                                    group.learnt[i] = move(group.learnt[i + step]);
+                                else
+                                    group.learnt[i] = mergeLearnt(group.learnt[i], group.learnt[i + step], group.base);
+                                group.readed[i] = true;
+                                group.learnt[i + step] = learnState(); });
+            }
+        }
+        if (!merging)
+            break;
+        pool.run();
+    }
+    for (unsigned int g = 0; g < groups.size(); g++)
+    {
+        if (groups[g].readed[0])
+            writeLearnState("learns/" + groups[g].ext + ".learn", groups[g].learnt[0], NULL, groups[g].base);
+    }
+    vector<string> extList;
+    for (auto it = byExtension.begin(); it != byExtension.end(); it++)
+        extList.push_back(it->first);
+    printLearnt(extList);
+    return;
+}
+
+//Reads the head and the tail of the file, only the bytes that the prints can compare.
+void readTarget(FILE *fileToIdentify, const printDB &db, target &t)
+{
+    phaseTimer timer(statTarget);
+    t.size = filesize(fileToIdentify);
+    t.head.resize(min(db.head->headWindow, t.size));
+    t.tail.resize(min(db.head->tailWindow, t.size));
+    countedSeek(fileToIdentify, 0);
+    t.head.resize(countedRead(t.head.data(), t.head.size(), fileToIdentify));
+    countedSeek(fileToIdentify, t.size - t.tail.size());
+    t.tail.resize(countedRead(t.tail.data(), t.tail.size(), fileToIdentify));
+}
+
+//Reads a stream (that can not seek) once from the beginning to the end: its first bytes are kept as the head, and the last ones in
+//a ring that becomes the tail at the end. The size of the stream is not known until the end, so only the frequencies of the
+//whole stream are measured (with all its bytes).
+void readStream(FILE *source, const printDB &db, target &t)
+{
+    phaseTimer timer(statTarget);
+    vector<unsigned char> block(learnBlock), ring(db.head->tailWindow);
+    unsigned long long int counts[256] = {};
+    size_t readed;
+    t.size = 0;
+    t.head.clear();
+    while ((readed = countedRead(block.data(), block.size(), source)) > 0)
+    {
+        if (t.head.size() < db.head->headWindow)
+            t.head.insert(t.head.end(), block.begin(), block.begin() + min((unsigned long long int)readed, db.head->headWindow - t.head.size()));
+        //Only the last ring.size() bytes of the block can reach the tail, the byte at position i of the stream goes to ring[i % ring.size()]:
+        for (size_t from = (readed > ring.size()) ? readed - ring.size() : 0; !ring.empty() && from < readed;)
+        {
+            size_t at = (t.size + from) % ring.size();
+            size_t len = min(readed - from, ring.size() - at);
+            memcpy(ring.data() + at, block.data() + from, len);
+            from += len;
+        }
+        if (db.hasHist && histBudget > 0)
+            byteHistogram(block.data(), readed, counts);
+        t.size += readed;
+    }
+    //We unroll the ring, from its oldest byte:
+    size_t tailLen = min((unsigned long long int)ring.size(), t.size);
+    t.tail.resize(tailLen);
+    for (size_t i = 0; i < tailLen; i++)
+        t.tail[i] = ring[(t.size - tailLen + i) % ring.size()];
+    if (db.hasHist && histBudget > 0)
+    {
+        for (unsigned int b = 0; b < 256; b++)
+            t.hist[0][b] = (t.size > 0) ? (float)counts[b] / t.size : 0;
+        t.histCount = 1;
+        t.hasHist = true;
+    }
+}
+
+//=true if the bytes of the segment are in bytes (size bytes) at the position start (or inside its window).
+bool matchAt(const printDB &db, const dbSegment &seg, const unsigned char *bytes, size_t size, long long int start)
+{
+    const header &headData = seg.head;
+    //First and last positions where the segment can start:
+    long long int lo = max(start - (long long int)headData.win, 0LL);
+    long long int hi = min(start + (long long int)headData.win, (long long int)size - (long long int)headData.tam);
+    if (lo > hi)
+        return false;
+    if (seg.mask != noMask)
+    { //The bytes between the joined strings are not compared:
+        for (long long int at = lo; at <= hi; at++)
+        {
+            if (maskedMatch(bytes + at, db.pool + seg.data, db.pool + seg.mask, headData.tam))
+                return true;
+        }
+        return false;
+    }
+    if (headData.win == 0)
+        return matchLength(bytes + start, db.pool + seg.data, headData.tam) == headData.tam;
+    size_t len = hi - lo + headData.tam;
+    return findSegment(bytes + lo, len, db.pool + seg.data, headData.tam) < len;
+}
+
+//=true if the bytes of the segment are in the file at the position indicated by its header (or inside its window).
+bool matchSegment(const printDB &db, const dbSegment &seg, const target &t)
+{
+    if (seg.head.ori == 'd')
+        return matchAt(db, seg, t.head.data(), t.head.size(), seg.head.pos);
+    if (seg.head.ori == 'i')
+        return matchAt(db, seg, t.tail.data(), t.tail.size(), (long long int)t.tail.size() - (long long int)seg.head.pos);
+    return false;
+}
+
+//Compares the file with one print, the main header first. When even matching all the segments that remain the print could not weigh
+//more than floor, it is discarded.
+guess evaluatePrint(const printDB &db, unsigned int p, const target &t, int floor)
+{
+    guess insertor;
+    insertor.ext = printName(db, p);
+    insertor.detectedPrints = 0;
+    insertor.totalPrints = db.prints[p].count;
+    insertor.comparedPrints = 0;
+    insertor.discarded = false;
+    insertor.firstHeaderStrike = false;
+    insertor.extensionInHeader = false;
+    insertor.histScore = -1;
+    if (t.hasHist && db.prints[p].hist != noHist)
+        insertor.histScore = histSimilarity(t.hist, (const float(*)[256])(db.pool + db.prints[p].hist), t.histCount);
+    int head = mainHeader(db, p);
+    for (int k = -1; k < (int)db.prints[p].count; k++)
+    {
+        //k = -1 is the main header, that is skipped later:
+        int s = (k == -1) ? head : db.prints[p].first + k;
+        if (s == -1 || (k >= 0 && s == head))
+            continue;
+        insertor.comparedPrints++;
+        if (matchSegment(db, db.segments[s], t))
+        {
+            insertor.detectedPrints++;
+            if (db.segments[s].head.pos == 0 && db.segments[s].head.ori == 'd')
+                insertor.firstHeaderStrike = true;
+        }
+        else if (answerWeight(insertor.totalPrints - insertor.comparedPrints + insertor.detectedPrints, insertor.totalPrints, insertor.firstHeaderStrike, insertor.histScore) < floor)
+        {
+            insertor.discarded = true;
+            break;
+        }
+    }
+    return insertor;
+}
+
+//A print is an answer only if some of its segments were found in the file, the frequencies alone do not list it.
+bool isAnswer(const guess &g)
+{
+    return g.detectedPrints > 0;
+}
+
+//Compares the file with the prints. First with the prints whose main header starts like the file, that are the most likely answers
+//and raise soon the weight that the others must reach. The rest are compared from the one that can weigh the most to the one that
+//can weigh the least, and only while they can enter in the topAnswers best answers found (a matching header does not stop them, a
+//print with many matching segments can weigh more than one that only matches a short header).
+vector<guess> evaluatePrints(const printDB &db, const target &t)
+{
+    phaseTimer timer(statCompare);
+    vector<guess> guesses;
+    vector<bool> evaluated(db.head->printCount, false);
+    priority_queue<int, vector<int>, greater<int>> best;                     // Weights of the best answers found, the lowest on top.
+    vector<tuple<unsigned int, unsigned int, unsigned long long int>> times; // Print, segments compared and time of each print, with --stats.
+    auto floor = [&]()
+    {
+        return (topAnswers > 0 && best.size() >= topAnswers) ? best.top() : INT_MIN;
+    };
+    auto evaluate = [&](unsigned int p)
+    {
+        chrono::steady_clock::time_point start;
+        if (statsMode != 0)
+            start = chrono::steady_clock::now();
+        guess insertor = evaluatePrint(db, p, t, floor());
+        if (statsMode != 0)
+            times.push_back(make_tuple(p, insertor.comparedPrints, statNanos(start)));
+        evaluated[p] = true;
+        if (insertor.discarded)
+            return;
+        guesses.push_back(insertor);
+        if (isAnswer(insertor))
+        {
+            best.push(answerWeight(insertor.detectedPrints, insertor.totalPrints, insertor.firstHeaderStrike, insertor.histScore));
+            if (topAnswers > 0 && best.size() > topAnswers)
+                best.pop();
+        }
+    };
+    for (unsigned int len = 1; len <= prefixLen && len <= t.head.size(); len++)
+    {
+        auto found = db.prefixes[len].find(prefixKey(t.head.data(), len));
+        if (found == db.prefixes[len].end())
+            continue;
+        for (unsigned int i = 0; i < found->second.size(); i++)
+            evaluate(found->second[i]);
+    }
+    for (unsigned int i = 0; i < db.byWeight.size(); i++)
+    {
+        unsigned int p = db.byWeight[i];
+        if (evaluated[p])
+            continue;
+        if (db.maxWeight[p] >= floor())
+            evaluate(p);
+        else if (statsMode == 0)
+            break; // The prints that follow can not weigh more.
+        else
+        {
+            statAdd(printsSkipped, 1);
+            statAdd(segmentsSkipped, db.prints[p].count);
+        }
+    }
+    //The counters of the extensions are shared by all the threads, they are added once per file:
+    if (statsMode != 0)
+    {
+        unsigned long long int compared = 0, skipped = 0;
+        lock_guard<mutex> guard(extensionStatsLock);
+        for (unsigned int i = 0; i < times.size(); i++)
+        {
+            unsigned int p = get<0>(times[i]);
+            extensionCounters &counters = extensionStats[printName(db, p)];
+            counters.evaluations++;
+            counters.segments += get<1>(times[i]);
+            counters.nanos += get<2>(times[i]);
+            compared += get<1>(times[i]);
+            skipped += db.prints[p].count - get<1>(times[i]);
+        }
+        statAdd(printsEvaluated, times.size());
+        statAdd(segmentsEvaluated, compared);
+        statAdd(segmentsSkipped, skipped);
+    }
+    return guesses;
+}
+
+//Gives a result: the topAnswers matching prints sorted from the most to the least probable (all of them if topAnswers = 0).
+vector<ans> rankAnswers(const vector<guess> &guesses)
+{
+    vector<ans> answers;
+    ans ansInsertor;
+    for (unsigned int i = 0; i < guesses.size(); i++)
+    {
+        ansInsertor.ext = guesses[i].ext;
+        ansInsertor.gotHeader = guesses[i].firstHeaderStrike;
+        ansInsertor.pcent = answerRate(guesses[i].detectedPrints, guesses[i].totalPrints);
+        //if(ansInsertor.pcent > 100) ansInsertor.pcent = 100;
+        //The similarity of the frequencies of the bytes adds up to histWeight (less than the main header):
+        ansInsertor.weight = answerWeight(guesses[i].detectedPrints, guesses[i].totalPrints, guesses[i].firstHeaderStrike, guesses[i].histScore);
+        ansInsertor.tp = guesses[i].totalPrints;
+        if (isAnswer(guesses[i]))
+            answers.push_back(ansInsertor);
+    }
+    sort(answers.begin(), answers.end(), compareAnswers);
+    if (topAnswers > 0 && answers.size() > topAnswers)
+        answers.resize(topAnswers);
+    return answers;
+}
+
+//=false if the file can not be read.
+bool identifyFile(const printDB &db, string filename, vector<ans> &answers)
+{
+    target t;
+    //"-" is the standard input, that is read as a stream:
+    if (filename == "-")
+        readStream(stdin, db, t);
+    else
+    { //We read the file only once, its head and its tail, and we compare them with the prints in memory:
+        FILE *fileToIdentify = fopen(filename.c_str(), "rb");
+        if (fileToIdentify == NULL)
+            return false;
+        readTarget(fileToIdentify, db, t);
+        if (db.hasHist && histBudget > 0)
+        {
+            fileHistograms(fileToIdentify, t.size, histBudget, t.hist);
+            t.hasHist = true;
+        }
+        fclose(fileToIdentify);
+    }
+    answers = rankAnswers(evaluatePrints(db, t));
+    return true;
+}
+
+void identify(string filename)
+{
+    printDB db;
+    vector<ans> answers;
+    if (!loadPrints(db))
+        return;
+    if (!identifyFile(db, filename, answers))
+    {
+        printHelp(2, filename);
+        return;
+    }
+    printf("\nResults: \n \n Extension | Success rate | Total prints \n");
+    if (answers.size() <= 45)
+    {
+        for (unsigned int i = 0; i < answers.size(); i++)
+        {
+            if (answers[i].gotHeader)
+                printf("  %10s| %22f| %15d   <= A header matching this extension was detected.\n", answers[i].ext.c_str(), answers[i].pcent, answers[i].tp);
+            else
+                printf("  %10s| %22f| %15d\n", answers[i].ext.c_str(), answers[i].pcent, answers[i].tp);
+        }
+    }
+    else
+    {
+        int auxC;
+        for (unsigned int i = 0; i < answers.size() && i <= 45; i++)
+        {
+            if (answers[i].gotHeader)
+                printf("  %10s| %22f| %15d   <= A header matching this extension was detected.\n", answers[i].ext.c_str(), answers[i].pcent, answers[i].tp);
+            else
+                printf("  %10s| %22f| %15d\n", answers[i].ext.c_str(), answers[i].pcent, answers[i].tp);
+            auxC = i;
+        }
+        printf(" %d Other possible extensions ...", (int)answers.size() - auxC);
+    }
+    printf("\n\n");
+    return;
+}
+
+//One line per file: <file> TAB <ext>:<weight>:<success rate>:<1 if the header matched, 0 if not> for each answer, separated by spaces.
+//"-" when no print matches and "?" when the file can not be read.
+string answerLine(string filename, const vector<ans> &answers, bool readed)
+{
+    string line = filename + "\t";
+    char field[64];
+    if (!readed)
+        line += "?";
+    else if (answers.empty())
+        line += "-";
+    for (unsigned int i = 0; readed && i < answers.size(); i++)
+    {
+        snprintf(field, sizeof(field), ":%d:%g:%d", answers[i].weight, answers[i].pcent, answers[i].gotHeader ? 1 : 0);
+        line += ((i > 0) ? " " : "") + answers[i].ext + field;
+    }
+    return line + "\n";
+}
+
+const unsigned int ringFiles = 32;    // Files that each ring reads at the same time.
+const unsigned int ringEntries = 256; // Operations that each ring can have in flight.
+const unsigned int ringOpen = ~0u;    // Number of the read of a file that is its open.
+
+//A file that is being read by a ring: its read 0 is the head, the read 1 is the tail and the others are the blocks of the frequencies.
+struct ringFile
+{
+    size_t index; // Position of the file in the list.
+    string name;
+    int fd = -1;
+    target t;
+    vector<histRead> blocks;
+    vector<vector<unsigned char>> blockBytes;
+    vector<unsigned long long int> done; // Bytes that each read has already read.
+    unsigned int reads = 0;              // Reads that are not completed.
+    bool failed = false;                 // =true if a read gave an error, the file can not be read.
+};
+
+//Identifies the files of the list from next on with an io_uring ring: the head, the tail and the blocks of the frequencies of many files
+//are read at the same time, and each file is compared with the prints as soon as all its reads are completed.
+//=false if there is no io_uring or the ring stops working, then the files that it was reading are put in unread, and they and the
+//files that are left must be read by the thread pool.
+bool identifyRing(const printDB &db, const vector<string> &files, atomic<size_t> &next, function<void(size_t, const vector<ans> &, bool)> report,
+                  vector<size_t> &unread)
+{
+    ioRing ring;
+    if (!ring.open(ringEntries))
+        return false;
+    phaseTimer timer(statTarget);
+    vector<ringFile> slots(ringFiles);
+    vector<unsigned int> freeSlots;
+    deque<pair<unsigned int, unsigned int>> waiting; // Opens and reads that did not fit in the ring (slot, read).
+    unsigned int busy = 0;
+    bool measure = db.hasHist && histBudget > 0;
+    for (unsigned int s = ringFiles; s > 0; s--)
+        freeSlots.push_back(s - 1);
+
+    auto buffer = [&](ringFile &f, unsigned int r) -> unsigned char *
+    {
+        return (r == 0) ? f.t.head.data() : (r == 1) ? f.t.tail.data() : f.blockBytes[r - 2].data();
+    };
+    auto length = [&](ringFile &f, unsigned int r) -> unsigned long long int
+    {
+        return (r == 0) ? f.t.head.size() : (r == 1) ? f.t.tail.size() : f.blocks[r - 2].len;
+    };
+    auto offset = [&](ringFile &f, unsigned int r) -> unsigned long long int
+    {
+        return (r == 0) ? 0 : (r == 1) ? f.t.size - f.t.tail.size() : f.blocks[r - 2].at;
+    };
+    auto finish = [&](unsigned int s, bool readed)
+    {
+        ringFile &f = slots[s];
+        vector<ans> answers;
+        if (f.fd >= 0)
+            close(f.fd);
+        if (readed)
+        {
+            if (measure)
+            {
+                phaseTimer histTimer(statHist);
+                unsigned long long int counts[histSections][256] = {};
+                for (unsigned int k = 0; k < f.blocks.size(); k++)
+                    byteHistogram(f.blockBytes[k].data(), f.done[k + 2], counts[1 + f.blocks[k].third]);
+                histFrequencies(counts, f.t.hist);
+                f.t.hasHist = true;
+            }
+            answers = rankAnswers(evaluatePrints(db, f.t));
+        }
+        report(f.index, answers, readed);
+        f = ringFile();
+        freeSlots.push_back(s);
+        busy--;
+    };
+    //The file is open: we know its size and we prepare its reads.
+    auto opened = [&](unsigned int s, int fd)
+    {
+        ringFile &f = slots[s];
+        struct stat info;
+        f.fd = fd;
+        if (fstat(fd, &info) != 0)
+        {
+            finish(s, false);
+            return;
+        }
+        f.t.size = info.st_size;
+        f.t.head.resize(min(db.head->headWindow, f.t.size));
+        f.t.tail.resize(min(db.head->tailWindow, f.t.size));
+        if (measure)
+            f.blocks = histBlocks(f.t.size, histBudget);
+        f.blockBytes.resize(f.blocks.size());
+        for (unsigned int k = 0; k < f.blocks.size(); k++)
+            f.blockBytes[k].resize(f.blocks[k].len);
+        f.done.assign(2 + f.blocks.size(), 0);
+        for (unsigned int r = 0; r < f.done.size(); r++)
+        {
+            if (length(f, r) == 0)
+                continue;
+            waiting.push_back({s, r});
+            f.reads++;
+        }
+        if (f.reads == 0)
+            finish(s, true);
+    };
+
+    while (true)
+    {
+        while (!freeSlots.empty() && next < files.size())
+        {
+            size_t i = next++;
+            if (i >= files.size())
+                break;
+            unsigned int s = freeSlots.back();
+            freeSlots.pop_back();
+            busy++;
+            slots[s].index = i;
+            slots[s].name = files[i];
+            waiting.push_back({s, ringOpen});
+        }
+        if (busy == 0)
+            break;
+        while (!waiting.empty())
+        {
+            unsigned int s = waiting.front().first, r = waiting.front().second;
+            ringFile &f = slots[s];
+            unsigned long long int tag = ((unsigned long long int)s << 32) | r;
+            bool queued = (r == ringOpen) ? ring.openFile(f.name.c_str(), tag)
+                                          : ring.read(f.fd, buffer(f, r) + f.done[r], length(f, r) - f.done[r], offset(f, r) + f.done[r], tag);
+            if (!queued)
+                break;
+            waiting.pop_front();
+        }
+        if (!ring.submit(true))
+        { //The ring does not work: the files that it was reading are given back to be read without it.
+            for (unsigned int s = 0; s < ringFiles; s++)
+            {
+                if (slots[s].name.empty())
+                    continue;
+                if (slots[s].fd >= 0)
+                    close(slots[s].fd);
+                unread.push_back(slots[s].index);
+            }
+            return false;
+        }
+        unsigned long long int tag;
+        int result;
+        while (ring.complete(tag, result))
+        {
+            unsigned int s = tag >> 32, r = tag & 0xFFFFFFFF;
+            ringFile &f = slots[s];
+            if (r == ringOpen)
+            {
+                statIO(0);
+                if (result < 0)
+                    finish(s, false);
+                else
+                    opened(s, result);
+                continue;
+            }
+            statIO(max(result, 0));
+            if (result > 0)
+            {
+                f.done[r] += result;
+                //The rest of a short read is asked again, like fread does:
+                if (f.done[r] < length(f, r))
+                {
+                    waiting.push_front({s, r});
+                    continue;
+                }
+            }
+            else if (result < 0)
+                f.failed = true;
+            else if (r < 2)
+                (r == 0 ? f.t.head : f.t.tail).resize(f.done[r]);
+            if (--f.reads == 0)
+                finish(s, !f.failed);
+        }
+    }
+    return true;
+}
+
+//Identifies every file of a list of files and directories (the directories are read recursively), on all the cores of the machine.
+//With io_uring the directories are read first, and then the files are read by the rings of the workers. The files that are in the
+//cache with the same size and modification time are answered without reading them.
+void identifyBatch(const vector<string> &paths)
+{
+    printDB db;
+    workPool pool;
+    mutex outputLock;
+    resultCache cache;
+    if (!loadPrints(db))
+        return;
+    if (useCache)
+        readCache(cache, db);
+
+    vector<string> files; // With io_uring the files are identified after the directories are read.
+    vector<struct stat> infos;
+    mutex filesLock;
+
+    function<void(string, const struct stat &, const vector<ans> &, bool)> answer = [&](string filename, const struct stat &info, const vector<ans> &answers, bool readed)
+    {
+        if (useCache && readed && filename != "-")
+            storeCached(cache, info, answers);
+        string line = answerLine(filename, answers, readed);
+        lock_guard<mutex> guard(outputLock);
+        fputs(line.c_str(), stdout);
+    };
+    function<void(size_t, const vector<ans> &, bool)> report = [&](size_t i, const vector<ans> &answers, bool readed)
+    {
+        answer(files[i], infos[i], answers, readed);
+    };
+    function<void(string, struct stat)> identifyTask = [&](string filename, struct stat info)
+    {
+        vector<ans> answers;
+        if (useCache && filename != "-" && findCached(cache, info, answers))
+        {
+            string line = answerLine(filename, answers, true);
+            lock_guard<mutex> guard(outputLock);
+            fputs(line.c_str(), stdout);
+            return;
+        }
+        if (useRing && filename != "-")
+        {
+            lock_guard<mutex> guard(filesLock);
+            files.push_back(filename);
+            infos.push_back(info);
+            return;
+        }
+        bool readed = identifyFile(db, filename, answers);
+        answer(filename, info, answers, readed);
+    };
+    function<void(string)> scanTask = [&](string dirname)
+    {
+        phaseTimer timer(statScan);
+        DIR *dir = opendir(dirname.c_str());
+        struct dirent *ent;
+        struct stat info;
+        if (dir == NULL)
+            return;
+        while ((ent = readdir(dir)) != NULL)
+        {
+            string name = ent->d_name;
+            statIO(0);
+            if (name == "." || name == "..")
+                continue;
+            string path = dirname + "/" + name;
+            //The links to directories are not followed, to avoid loops:
+            if (lstat(path.c_str(), &info) != 0)
+                continue;
+            if (S_ISDIR(info.st_mode))
+                pool.submit([&scanTask, path]
+                            { scanTask(path); });
+            else if (S_ISREG(info.st_mode) || (S_ISLNK(info.st_mode) && stat(path.c_str(), &info) == 0 && S_ISREG(info.st_mode)))
+                pool.submit([&identifyTask, path, info]
+                            { identifyTask(path, info); });
+        }
+        closedir(dir);
+    };
+
+    for (unsigned int i = 0; i < paths.size(); i++)
+    {
+        struct stat info = {};
+        string path = paths[i];
+        if (path == "-")
+            pool.submit([&identifyTask, path, info]
+                        { identifyTask(path, info); });
+        else if (stat(path.c_str(), &info) != 0)
+            printHelp(2, path);
+        else if (S_ISDIR(info.st_mode))
+        {
+            while (path.size() > 1 && path.back() == '/')
+                path.pop_back();
+            pool.submit([&scanTask, path]
+                        { scanTask(path); });
+        }
+        else
+            pool.submit([&identifyTask, path, info]
+                        { identifyTask(path, info); });
+    }
+    pool.run();
+    //Every worker reads its files with its own ring, if there is no io_uring the thread pool reads them:
+    atomic<size_t> next{0};
+    for (unsigned int w = 0; w < pool.size() && !files.empty(); w++)
+        pool.submit([&]
+                    {
+                        vector<size_t> unread;
+                        if (identifyRing(db, files, next, report, unread))
+                            return;
+                        for (unsigned int u = 0; u < unread.size(); u++)
+                        {
+                            vector<ans> answers;
+                            bool readed = identifyFile(db, files[unread[u]], answers);
+                            report(unread[u], answers, readed);
+                        }
+                        for (size_t i = next++; i < files.size(); i = next++)
+                        {
+                            vector<ans> answers;
+                            bool readed = identifyFile(db, files[i], answers);
+                            report(i, answers, readed);
+                        }
+                    });
+    pool.run();
+    if (useCache)
+        writeCache(cache);
+    return;
+}
+
+//CARVING:
+/* With --carve the files inside a raw image (of a disk, of the memory...) are searched without knowing where they start or end: the
+* main headers of the prints are searched at every position of the image, and where one matches the rest of the straight segments of
+* its print are compared from there. Only the prints whose main header begins with at least 2 compared bytes (its prefix, up to 4) can
+* be carved, and not the ones whose prefix is one byte repeated (like 00 00 00 00), that would make a candidate of every byte of an
+* empty area of a disk (they are listed in stderr).
+* The positions are filtered with the third and fourth bytes of the prefixes of 4 bytes (the first ones are often zeros, as in the boxes
+* of mp4), and with the first and second bytes of the shorter ones (like FF D8 FF of jpg or BM of bmp), in two scans of the image:
+* 32 (AVX2) or 16 (SSSE3) positions at a time by the classes of those bytes, then with a table of those pairs (65536 entries), and then
+* the whole prefix is checked before the position is a candidate.
+* The image is mapped in memory and cut in chunks that the threads scan, each chunk gives the files that start in it but its
+* comparisons can read the bytes of the next chunks. One line is given per file found: <offset> TAB <extension> TAB <score>, where
+* the score is the weight of the answer counting only the straight segments (the end of the file is not known).
+*/
+const unsigned long long int carveChunk = 16 << 20; //Bytes of the image scanned by each task.
+
+//The prefixes of some lengths, filtered by a pair of their bytes (bytes at and at + 1). Classes of the first byte of the pair (j = 0) and
+//of the second (j = 1): a byte b can be one of them if lo[j][b & 15] & hi[j][b >> 4] is not 0 (there are false candidates when two bytes
+//share the low half and their high halves are 8 apart).
+struct carveFilter
+{
+    alignas(16) unsigned char lo[2][16];
+    alignas(16) unsigned char hi[2][16];
+    unsigned int at;                                       // 2 for the prefixes of 4 bytes, 0 for the shorter ones.
+    vector<unsigned int> pairs;                            // For the bytes of the pair (first | second << 8): 0 if no prefix has them, or 1 + their group.
+    vector<vector<pair<unsigned int, unsigned int>>> prefixes; // The prefixes of each group (prefixKey, mask of its length).
+};
+
+//=true if the prefix of a main header starts at bytes (4 bytes can be read).
+inline bool carveCandidate(const carveFilter &filter, const unsigned char *bytes)
+{
+    unsigned int group = filter.pairs[bytes[filter.at] | (unsigned int)bytes[filter.at + 1] << 8];
+    if (group == 0)
+        return false;
+    const vector<pair<unsigned int, unsigned int>> &keys = filter.prefixes[group - 1];
+    unsigned int four = prefixKey(bytes, 4);
+    for (unsigned int k = 0; k < keys.size(); k++)
+        if ((four & keys[k].second) == keys[k].first)
+            return true;
+    return false;
+}
+
+//Adds a prefix to the filter, its bytes at and at + 1 are the pair.
+void carveAdd(carveFilter &filter, const unsigned char *prefix, unsigned int len)
+{
+    unsigned int key = prefixKey(prefix, len), mask = (len == 4) ? ~0U : (1U << (8 * len)) - 1, pairKey = prefixKey(prefix + filter.at, 2);
+    if (filter.pairs[pairKey] == 0)
+    {
+        filter.prefixes.push_back({});
+        filter.pairs[pairKey] = filter.prefixes.size();
+    }
+    vector<pair<unsigned int, unsigned int>> &keys = filter.prefixes[filter.pairs[pairKey] - 1];
+    if (find(keys.begin(), keys.end(), make_pair(key, mask)) == keys.end())
+        keys.push_back({key, mask});
+    for (unsigned int j = 0; j < 2; j++)
+    {
+        unsigned char b = prefix[filter.at + j];
+        filter.lo[j][b & 15] |= 1 << ((b >> 4) & 7);
+        filter.hi[j][b >> 4] |= 1 << ((b >> 4) & 7);
+    }
+}
+
+void carveScanScalar(const unsigned char *image, size_t from, size_t to, const carveFilter &filter, vector<size_t> &candidates)
+{
+    for (size_t i = from; i < to; i++)
+    {
+        if (carveCandidate(filter, image + i))
+            candidates.push_back(i);
+    }
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+__attribute__((target("ssse3"))) void carveScanSSSE3(const unsigned char *image, size_t from, size_t to, const carveFilter &filter, vector<size_t> &candidates)
+{
+    __m128i low = _mm_set1_epi8(0x0F), zero = _mm_setzero_si128();
+    __m128i lo0 = _mm_load_si128((const __m128i *)filter.lo[0]), hi0 = _mm_load_si128((const __m128i *)filter.hi[0]);
+    __m128i lo1 = _mm_load_si128((const __m128i *)filter.lo[1]), hi1 = _mm_load_si128((const __m128i *)filter.hi[1]);
+    size_t i = from;
+    for (; i + 16 <= to; i += 16)
+    {
+        __m128i x = _mm_loadu_si128((const __m128i *)(image + i + filter.at));
+        __m128i y = _mm_loadu_si128((const __m128i *)(image + i + filter.at + 1));
+        __m128i cx = _mm_and_si128(_mm_shuffle_epi8(lo0, _mm_and_si128(x, low)), _mm_shuffle_epi8(hi0, _mm_and_si128(_mm_srli_epi16(x, 4), low)));
+        __m128i cy = _mm_and_si128(_mm_shuffle_epi8(lo1, _mm_and_si128(y, low)), _mm_shuffle_epi8(hi1, _mm_and_si128(_mm_srli_epi16(y, 4), low)));
+        unsigned int found = ~_mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(cx, zero), _mm_cmpeq_epi8(cy, zero))) & 0xFFFF;
+        for (; found != 0; found &= found - 1)
+        {
+            size_t at = i + __builtin_ctz(found);
+            if (carveCandidate(filter, image + at))
+                candidates.push_back(at);
+        }
+    }
+    carveScanScalar(image, i, to, filter, candidates);
+}
+
+__attribute__((target("avx2"))) void carveScanAVX2(const unsigned char *image, size_t from, size_t to, const carveFilter &filter, vector<size_t> &candidates)
+{
+    __m256i low = _mm256_set1_epi8(0x0F), zero = _mm256_setzero_si256();
+    __m256i lo0 = _mm256_broadcastsi128_si256(_mm_load_si128((const __m128i *)filter.lo[0]));
+    __m256i hi0 = _mm256_broadcastsi128_si256(_mm_load_si128((const __m128i *)filter.hi[0]));
+    __m256i lo1 = _mm256_broadcastsi128_si256(_mm_load_si128((const __m128i *)filter.lo[1]));
+    __m256i hi1 = _mm256_broadcastsi128_si256(_mm_load_si128((const __m128i *)filter.hi[1]));
+    size_t i = from;
+    for (; i + 32 <= to; i += 32)
+    {
+        __m256i x = _mm256_loadu_si256((const __m256i *)(image + i + filter.at));
+        __m256i y = _mm256_loadu_si256((const __m256i *)(image + i + filter.at + 1));
+        __m256i cx = _mm256_and_si256(_mm256_shuffle_epi8(lo0, _mm256_and_si256(x, low)), _mm256_shuffle_epi8(hi0, _mm256_and_si256(_mm256_srli_epi16(x, 4), low)));
+        __m256i cy = _mm256_and_si256(_mm256_shuffle_epi8(lo1, _mm256_and_si256(y, low)), _mm256_shuffle_epi8(hi1, _mm256_and_si256(_mm256_srli_epi16(y, 4), low)));
+        unsigned int found = ~_mm256_movemask_epi8(_mm256_or_si256(_mm256_cmpeq_epi8(cx, zero), _mm256_cmpeq_epi8(cy, zero)));
+        for (; found != 0; found &= found - 1)
+        {
+            size_t at = i + __builtin_ctz(found);
+            if (carveCandidate(filter, image + at))
+                candidates.push_back(at);
+        }
+    }
+    carveScanScalar(image, i, to, filter, candidates);
+}
+#endif
+
+//carveScan(image, from, to, filter, candidates) adds the positions in [from, to) where a prefix of the filter starts
+//(image[to + 2] must exist). It is chosen like matchLength.
+void (*chooseCarveScan())(const unsigned char *, size_t, size_t, const carveFilter &, vector<size_t> &)
+{
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2"))
+        return carveScanAVX2;
+    if (__builtin_cpu_supports("ssse3"))
+        return carveScanSSSE3;
+#endif
+    return carveScanScalar;
+}
+
+void (*const carveScan)(const unsigned char *, size_t, size_t, const carveFilter &, vector<size_t> &) = chooseCarveScan();
+
+struct carveHit
+{
+    unsigned long long int offset;
+    unsigned int p;
+    int score;
+};
+
+//Score of the print p for a file that starts at bytes (size bytes until the end of the image), -1 if its main header (head) is not there.
+int carvePrint(const printDB &db, unsigned int p, int head, const unsigned char *bytes, size_t size)
+{
+    unsigned int detected = 1, total = 1;
+    if (!matchAt(db, db.segments[head], bytes, size, 0))
+        return -1;
+    for (unsigned int s = db.prints[p].first; s < db.prints[p].first + db.prints[p].count; s++)
+    {
+        if ((int)s == head || db.segments[s].head.ori != 'd')
+            continue;
+        total++;
+        if (matchAt(db, db.segments[s], bytes, size, db.segments[s].head.pos))
+            detected++;
+    }
+    return answerWeight(detected, total, true, -1);
+}
+
+void carve(string imagePath)
+{
+    printDB db;
+    if (!loadPrints(db))
+        return;
+    int fd = open(imagePath.c_str(), O_RDONLY);
+    struct stat info;
+    if (fd == -1 || fstat(fd, &info) != 0)
+    {
+        printHelp(2, imagePath);
+        if (fd != -1)
+            close(fd);
+        return;
+    }
+    size_t size = info.st_size;
+    const unsigned char *image = (size > 0) ? (const unsigned char *)mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0) : NULL;
+    close(fd);
+    if (image == MAP_FAILED || image == NULL)
+    {
+        printHelp(2, imagePath);
+        return;
+    }
+    madvise((void *)image, size, MADV_SEQUENTIAL);
+
+    //The prints that can be carved, by the prefix of their main header (filters[0] for the prefixes of 4 bytes, filters[1] for the
+    //prefixes of 2 and 3 bytes):
+    carveFilter filters[2] = {};
+    filters[0].at = 2;
+    filters[0].pairs.assign(1 << 16, 0);
+    filters[1].at = 0;
+    filters[1].pairs.assign(1 << 16, 0);
+    unordered_map<unsigned int, vector<pair<unsigned int, int>>> byPrefix[prefixLen + 1];
+    string uncarved;
+    for (unsigned int p = 0; p < db.head->printCount; p++)
+    {
+        int s = mainHeader(db, p);
+        unsigned int len = 0;
+        while (s != -1 && len < min(db.segments[s].head.tam, prefixLen) && (db.segments[s].mask == noMask || db.pool[db.segments[s].mask + len] != 0))
+            len++;
+        const unsigned char *prefix = (s != -1) ? db.pool + db.segments[s].data : NULL;
+        bool repeated = true;
+        for (unsigned int i = 1; i < len && repeated; i++)
+            repeated = prefix[i] == prefix[0];
+        if (len < 2 || repeated)
+        {
+            uncarved += (uncarved.empty() ? "" : ", ") + printName(db, p);
+            continue;
+        }
+        carveAdd(filters[(len == 4) ? 0 : 1], prefix, len);
+        byPrefix[len][prefixKey(prefix, len)].push_back({p, s});
+    }
+    if (!uncarved.empty())
+        fprintf(stderr, "Not carved (their main header has less than 2 compared bytes, or one byte repeated): %s\n", uncarved.c_str());
+
+    workPool pool;
+    vector<vector<carveHit>> hits((size >= 4) ? (size + carveChunk - 1) / carveChunk : 0);
+    for (unsigned long long int c = 0; c < hits.size(); c++)
+    {
+        pool.submit([&, c]
+                    {
+                        unsigned long long int from = c * carveChunk;
+                        unsigned long long int to = min(from + carveChunk, (unsigned long long int)size - 3);
+                        for (unsigned int f = 0; f < 2; f++)
+                        {
+                            vector<size_t> positions;
+                            if (!filters[f].prefixes.empty())
+                                carveScan(image, from, to, filters[f], positions);
+                            for (unsigned int n = 0; n < positions.size(); n++)
+                            {
+                                size_t i = positions[n];
+                                size_t window = min((unsigned long long int)size - i, db.head->headWindow);
+                                for (unsigned int len = (f == 0) ? 4 : 2; len <= ((f == 0) ? 4u : 3u); len++)
+                                {
+                                    auto found = byPrefix[len].find(prefixKey(image + i, len));
+                                    for (unsigned int k = 0; found != byPrefix[len].end() && k < found->second.size(); k++)
+                                    {
+                                        int score = carvePrint(db, found->second[k].first, found->second[k].second, image + i, window);
+                                        if (score >= 0)
+                                            hits[c].push_back({i, found->second[k].first, score});
+                                    }
+                                }
+                            }
+                        } });
+    }
+    pool.run();
+    for (unsigned int c = 0; c < hits.size(); c++)
+    {
+        //Several prints can start at the same offset, the best first:
+        stable_sort(hits[c].begin(), hits[c].end(), [](const carveHit &a, const carveHit &b)
+                    { return a.offset < b.offset || (a.offset == b.offset && a.score > b.score); });
+        for (unsigned int i = 0; i < hits[c].size(); i++)
+            printf("%llu\t%s\t%d\n", hits[c][i].offset, printName(db, hits[c][i].p).c_str(), hits[c][i].score);
+    }
+    munmap((void *)image, size);
+    return;
+}
+
+//IDENTIFY SERVER:
+/* With --serve the prints are loaded once and the program waits for requests in a unix socket, each client can send as many lines as it wants:
+* -> <file to identify> : the answer is the line of the file, the same that -i gives for several files.
+* -> RELOAD : the prints are loaded again (after using -p or -c), the answer is "OK" or "ERROR".
+* -> STATS : the statistics of the server as one line of JSON (empty counters if it was not started with --stats).
+*/
+struct printServer
+{
+    shared_ptr<printDB> db; // The requests that are running keep the prints they started with until they end.
+    mutex dbLock;
+};
+
+bool sendAll(int client, string text)
+{
+    size_t sent = 0;
+    while (sent < text.size())
+    {
+        ssize_t done = send(client, text.data() + sent, text.size() - sent, MSG_NOSIGNAL);
+        if (done <= 0)
+            return false;
+        sent += done;
+    }
+    return true;
+}
+
+void serveClient(printServer &server, int client)
+{
+    string pending, request, reply;
+    char buffer[4096];
+    ssize_t readed;
+    while ((readed = recv(client, buffer, sizeof(buffer), 0)) > 0)
+    {
+        pending.append(buffer, readed);
+        size_t end;
+        while ((end = pending.find('\n')) != string::npos)
+        {
+            request = pending.substr(0, end);
+            pending.erase(0, end + 1);
+            if (!request.empty() && request.back() == '\r')
+                request.pop_back();
+            if (request.empty())
+                continue;
+            if (request == "STATS")
+                reply = statsJson() + "\n";
+            else if (request == "RELOAD")
+            {
+                shared_ptr<printDB> reloaded = make_shared<printDB>();
+                reply = "ERROR\n";
+                if (loadPrints(*reloaded))
+                {
+                    lock_guard<mutex> guard(server.dbLock);
+                    server.db = reloaded;
+                    reply = "OK\n";
+                }
+            }
+            else
+            {
+                shared_ptr<printDB> db;
+                vector<ans> answers;
+                {
+                    lock_guard<mutex> guard(server.dbLock);
+                    db = server.db;
+                }
+                //"-" would be the standard input of the server, it is not readable for a client:
+                bool found = request != "-" && identifyFile(*db, request, answers);
+                reply = answerLine(request, answers, found);
+            }
+            if (!sendAll(client, reply))
+                break;
+        }
+    }
+    close(client);
+}
+
+void serve(string socketPath)
+{
+    printServer server;
+    sockaddr_un address = {};
+    server.db = make_shared<printDB>();
+    if (!loadPrints(*server.db))
+        return;
+    int listener = socket(AF_UNIX, SOCK_STREAM, 0);
+    address.sun_family = AF_UNIX;
+    if (listener == -1 || socketPath.size() >= sizeof(address.sun_path))
+    {
+        printHelp(9, socketPath);
+        return;
+    }
+    strcpy(address.sun_path, socketPath.c_str());
+    //The socket of a previous server is replaced, but any other file is left as it is:
+    struct stat info;
+    if (lstat(socketPath.c_str(), &info) == 0)
+    {
+        if (!S_ISSOCK(info.st_mode))
+        {
+            printHelp(12, socketPath);
+            close(listener);
+            return;
+        }
+        unlink(socketPath.c_str());
+    }
+    if (bind(listener, (sockaddr *)&address, sizeof(address)) != 0 || listen(listener, SOMAXCONN) != 0)
+    {
+        printHelp(9, socketPath);
+        close(listener);
+        return;
+    }
+    printf("\nPrintTracker is waiting for files to identify in \"%s\" (%u prints loaded).\n\n", socketPath.c_str(), server.db->head->printCount);
+    fflush(stdout);
+    //Every client is attended in its own thread:
+    while (true)
+    {
+        int client = accept(listener, NULL, NULL);
+        if (client == -1)
+        { //Without free descriptors (EMFILE...) accept fails until some client ends, so we wait a little before trying again:
+            if (errno != EINTR && errno != ECONNABORTED)
+            {
+                fprintf(stderr, "PrintTracker could not accept a client: %s\n", strerror(errno));
+                this_thread::sleep_for(chrono::milliseconds(100));
+            }
+            continue;
+        }
+        thread(serveClient, ref(server), client).detach();
+    }
+}
+
+//BENCHMARK:
+/* With --bench a synthetic corpus is generated in the indicated directory (always the same, the random generator has a fixed seed), with files of
+* known formats: their real headers and tails around random payloads of many sizes. Then learn, print and identify are timed with it and the
+* throughput, the latencies of identify and how many files were identified correctly (top-1 accuracy) are reported.
+*/
+const unsigned int benchLearnFiles = 20;      //Files of each format that are learnt.
+const unsigned int benchTestFiles = 50;       //Files of each format that are identified.
+const unsigned int benchMinSize = 1 << 10;    //The payloads have from 1 KiB...
+const unsigned int benchMaxSize = 512 << 10;  //...to 512 KiB.
+
+const unsigned int benchFormatCount = 10;
+const string benchExts[benchFormatCount] = {"jpg", "png", "pdf", "docx", "avi", "m4a", "gif", "bmp", "mp3", "rar"};
+
+string benchBytes(mt19937 &random, unsigned int len, bool text)
+{
+    string retMe(len, 0);
+    for (unsigned int i = 0; i < len; i++)
+        retMe[i] = text ? "abcdefghijklmnopqrstuvwxyz0123456789 /<>\n"[random() % 41] : (char)(random() & 0xFF);
+    return retMe;
+}
+
+//Content of a file of the format f: its header and tail around a random payload. The fields that change from one file to another are random too.
+string benchContent(unsigned int f, mt19937 &random)
+{
+    //Log-uniform sizes, so there are small and big files:
+    unsigned int len = benchMinSize * pow((double)benchMaxSize / benchMinSize, (random() % 1000) / 1000.0);
+    string size = benchBytes(random, 4, false);
+    string head, tail;
+    bool text = false;
+    switch (f)
+    {
+    case 0:
+        head = string("\xFF\xD8\xFF\xE0\x00\x10JFIF\x00\x01\x01\x00\x00\x01\x00\x01\x00\x00", 20);
+        tail = "\xFF\xD9";
+        break;
+    case 1:
+        head = string("\x89PNG\r\n\x1A\n\x00\x00\x00\rIHDR", 16) + size + size + string("\x08\x02\x00\x00\x00", 5);
+        tail = string("\x00\x00\x00\x00IEND\xAE\x42\x60\x82", 12);
+        break;
+    case 2:
+        head = "%PDF-1." + to_string(4 + random() % 4) + "\n%\xE2\xE3\xCF\xD3\n";
+        tail = "trailer\n<< /Size 22 >>\nstartxref\n" + to_string(random() % 10000000) + "\n%%EOF\n";
+        text = true;
+        break;
+    case 3:
+        head = string("PK\x03\x04\x14\x00\x06\x00\x08\x00\x00\x00!\x00", 14) + size + string("\x13\x00\x08\x02[Content_Types].xml", 23);
+        tail = string("PK\x05\x06\x00\x00\x00\x00", 8) + size;
+        break;
+    case 4:
+        head = "RIFF" + size + "AVI LIST" + size + string("hdrlavih8\x00\x00\x00", 12);
+        tail = "idx1" + size;
+        break;
+    case 5:
+        head = string("\x00\x00\x00\x20" "ftypM4A \x00\x00\x00\x00M4A mp42isom", 28);
+        break;
+    case 6:
+        head = "GIF89a" + size;
+        tail = string("\x00;", 2);
+        break;
+    case 7:
+        head = "BM" + size + string("\x00\x00\x00\x00\x36\x00\x00\x00\x28\x00\x00\x00", 12);
+        break;
+    case 8:
+        head = string("ID3\x03\x00\x00\x00", 7) + size;
+        tail = "TAG";
+        break;
+    default:
+        head = string("Rar!\x1A\x07\x00", 7);
+        tail = string("\xC4\x3D\x7B\x00\x40\x07\x00", 7);
+        break;
+    }
+    return head + benchBytes(random, len, text) + tail;
+}
+
+double benchSeconds(chrono::steady_clock::time_point since)
+{
+    return chrono::duration<double>(chrono::steady_clock::now() - since).count();
+}
+
+void benchmark(string directory)
+{
+    mt19937 random(2021);
+    vector<string> learnPaths, testPaths, testExts;
+    unsigned long long int learnBytes = 0;
+
+    //We work inside the directory, with its own "learns" and "prints" folders:
+    mkdir(directory.c_str(), 0755);
+    if (chdir(directory.c_str()) != 0)
+    {
+        printHelp(2, directory);
+        return;
+    }
+    mkdir("corpus", 0755);
+    mkdir("prints", 0755);
+    remove(dbPath.c_str());
+    printf("\nGenerating the corpus in \"%s/corpus\" ...\n", directory.c_str());
+    for (unsigned int f = 0; f < benchFormatCount; f++)
+    {
+        remove(("learns/" + benchExts[f] + ".learn").c_str());
+        remove(("prints/" + benchExts[f] + ".print").c_str());
+        for (unsigned int i = 0; i < benchLearnFiles + benchTestFiles; i++)
+        {
+            //The files to learn have extension, the files to identify do not:
+            string path = "corpus/" + to_string(f * 1000 + i);
+            string content = benchContent(f, random);
+            if (i < benchLearnFiles)
+            {
+                path += "." + benchExts[f];
+                learnPaths.push_back(path);
+                learnBytes += content.size();
+            }
+            else
+            {
+                testPaths.push_back(path);
+                testExts.push_back(benchExts[f]);
+            }
+            FILE *output = fopen(path.c_str(), "wb");
+            fwrite(content.data(), 1, content.size(), output);
+            fclose(output);
+        }
+    }
+
+    //LEARN (the prints are made once, in their own phase):
+    auto start = chrono::steady_clock::now();
+    for (unsigned int i = 0; i < learnPaths.size(); i++)
+        learn(learnPaths[i], false);
+    double learnTime = benchSeconds(start);
+    //PRINT:
+    start = chrono::steady_clock::now();
+    generatePrints(vector<string>(benchExts, benchExts + benchFormatCount));
+    double printTime = benchSeconds(start);
+    start = chrono::steady_clock::now();
+    compilePrints();
+    double compileTime = benchSeconds(start);
+    //IDENTIFY:
+    printDB db;
+    start = chrono::steady_clock::now();
+    if (!loadPrints(db))
+        return;
+    double loadTime = benchSeconds(start);
+    vector<double> latencies;
+    unsigned int correct = 0;
+    start = chrono::steady_clock::now();
+    for (unsigned int i = 0; i < testPaths.size(); i++)
+    {
+        vector<ans> answers;
+        auto fileStart = chrono::steady_clock::now();
+        identifyFile(db, testPaths[i], answers);
+        latencies.push_back(benchSeconds(fileStart) * 1e6);
+        if (!answers.empty() && answers[0].ext == testExts[i])
+            correct++;
+    }
+    double identifyTime = benchSeconds(start);
+    sort(latencies.begin(), latencies.end());
+
+    printf("\nResults: \n \n");
+    printf("  learn    : %u files, %.1f MB in %.3f s => %.1f MB/s\n", (unsigned)learnPaths.size(), learnBytes / 1e6, learnTime, learnBytes / 1e6 / learnTime);
+    printf("  print    : %u extensions in %.3f s => %.2f ms per print\n", benchFormatCount, printTime, printTime * 1000 / benchFormatCount);
+    printf("  compile  : %.3f ms, load: %.3f ms\n", compileTime * 1000, loadTime * 1000);
+    printf("  identify : %u files in %.3f s => %.0f files/s\n", (unsigned)testPaths.size(), identifyTime, testPaths.size() / identifyTime);
+    printf("             latency p50 %.1f us, p90 %.1f us, p99 %.1f us, max %.1f us\n", latencies[latencies.size() / 2], latencies[latencies.size() * 9 / 10],
+           latencies[latencies.size() * 99 / 100], latencies.back());
+    printf("             top-1 accuracy %.2f %% (%u of %u)\n\n", correct * 100.0 / testPaths.size(), correct, (unsigned)testPaths.size());
+    return;
+}
+
+int main(int argc, char *argv[])
+{
+    //We take out the options, they can be anywhere in the command:
+    vector<string> args;
+    for (int i = 0; i < argc; i++)
+    {
+        string arg = argv[i];
+        if (arg == "--budget" && i + 1 < argc)
+            histBudget = strtoull(argv[++i], NULL, 10);
+        else if (arg == "--window" && i + 1 < argc)
+        {
+            //<head>:<tail>[:<interior blocks>] or "all":
+            string window = argv[++i];
+            char *end;
+            learnHead = learnTail = ~0ULL;
+            learnInterior = 0;
+            if (window != "all")
+            {
+                learnHead = strtoull(window.c_str(), &end, 10);
+                learnTail = (*end == ':') ? strtoull(end + 1, &end, 10) : learnHead;
+                learnInterior = (*end == ':') ? strtoul(end + 1, &end, 10) : 0;
+            }
+        }
+        else if (arg == "--no-cache")
+            useCache = false;
+        else if (arg == "--io" && i + 1 < argc)
+            useRing = string(argv[++i]) != "threads";
+        else if (arg == "--top" && i + 1 < argc)
+            topAnswers = strtoul(argv[++i], NULL, 10);
+        else if (arg == "--stats" || arg == "--stats=json")
+            statsMode = (arg == "--stats") ? 1 : 2;
+        else
+            args.push_back(arg);
+    }
+    argc = args.size();
+    //We review the command that the user gives us:
+    if (argc == 2 && (args[1] == "-c" || args[1] == "--embed"))
+    {
+        if (args[1] == "-c")
+            compilePrints();
+        else
+            embedPrints();
+        if (statsMode != 0)
+            printStats();
+        return 0;
+    }
+    if (argc <= 2)
+    {
+        printHelp(-1, "");
+        return 0;
+    }
+    if (argc == 3)
+    {
+        if (args[1] == "-l")
+        {
+            struct stat info;
+            if (stat(args[2].c_str(), &info) != 0 || (!S_ISDIR(info.st_mode) && !S_ISREG(info.st_mode)))
+                printHelp(2, args[2]);
+            else if (S_ISDIR(info.st_mode))
+                learnBatch(vector<string>(args.begin() + 2, args.end()));
+            else
+                learn(args[2]);
+        }
+        else if (args[1] == "-p")
+        {
+            if (args[2] == "--all")
+                generateAllPrints();
+            else
+                generatePrint(args[2]);
+        }
+        else if (args[1] == "--serve")
+        {
+            serve(args[2]);
+        }
+        else if (args[1] == "--carve")
+        {
+            carve(args[2]);
+        }
+        else if (args[1] == "--bench")
+        {
+            benchmark(args[2]);
+        }
+        else if (args[1] == "-i")
+        {
+            struct stat info;
+            if (args[2] == "-")
+                identify(args[2]);
+            else if (stat(args[2].c_str(), &info) != 0)
+                printHelp(2, args[2]);
+            else if (S_ISDIR(info.st_mode))
+                identifyBatch(vector<string>(args.begin() + 2, args.end()));
             else
-                printHelp(2, argv[2]);
+                identify(args[2]);
         }
         else
         {
-            printHelp(1, argv[1]);
+            printHelp(1, args[1]);
         }
     }
+    else if (args[1] == "-l")
+        learnBatch(vector<string>(args.begin() + 2, args.end()));
+    else if (args[1] == "-i")
+        identifyBatch(vector<string>(args.begin() + 2, args.end()));
     else
         printHelp(0, "");
 
+    if (statsMode != 0)
+        printStats();
     return 0;
 }